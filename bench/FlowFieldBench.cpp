@@ -0,0 +1,388 @@
+/**
+ * FlowFieldBench.cpp
+ * Standalone benchmark for the flow field kernels, built without Godot.
+ * Runs both integration engines plus direction and line-of-sight extraction on
+ * synthetic (uniform noise) and seeded (clustered) maps across sizes and obstacle
+ * densities, and reports ms per field, cells/s and peak memory, optionally as JSON.
+ * Smoothed single-unit A* paths are timed on the same maps; the field/path time ratio
+ * is the selection size above which one shared field beats per-unit paths.
+ *
+ * Usage: flow_field_bench [--sizes 64,128,...] [--densities 0,10,...] [--iterations N]
+ *                         [--seed N] [--path-weight W] [--json path] [--label text]
+ */
+
+#include "FlowFieldCore.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace rts;
+
+namespace {
+
+struct BenchOptions {
+    std::vector<int> sizes = {64, 128, 256, 512, 1024, 2048};
+    std::vector<int> densities = {0, 10, 20, 30, 40};
+    int iterations = 5;
+    uint32_t seed = 12345u;
+    float path_weight = PATH_HEURISTIC_WEIGHT;
+    std::string json_path;
+    std::string label;
+};
+
+struct BenchResult {
+    const char *map = "";
+    const char *engine = "";
+    int size = 0;
+    int density = 0;
+    double mean_ms = 0.0;
+    double min_ms = 0.0;
+    double cells_per_sec = 0.0;
+    size_t reached_cells = 0;
+    size_t field_bytes = 0;
+    double crossover_units = 0.0;
+};
+
+// Far starts per A* case, so the timing reflects cross-map orders
+const int PATH_STARTS = 32;
+
+std::vector<int> parse_list(const char *text) {
+    std::vector<int> values;
+    for (const char *p = text; *p;) {
+        values.push_back(std::atoi(p));
+        const char *comma = std::strchr(p, ',');
+        if (!comma) break;
+        p = comma + 1;
+    }
+    return values;
+}
+
+uint32_t next_random(uint32_t &state) {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+void block_cell(FlowGrid &grid, int index) {
+    grid.set_walkable(index, false);
+    grid.set_cost(index, FLOW_COST_IMPASSABLE);
+}
+
+// Independent per-cell obstacles; ~a fifth of the open cells are rough ground
+void fill_synthetic(FlowGrid &grid, int density, uint32_t seed) {
+    uint32_t state = seed;
+    const int cell_count = grid.width * grid.height;
+    for (int i = 0; i < cell_count; i++) {
+        uint32_t roll = next_random(state) % 100;
+        if (roll < static_cast<uint32_t>(density)) {
+            block_cell(grid, i);
+        } else if (roll < static_cast<uint32_t>(density) + 20) {
+            grid.set_cost(i, FLOW_COST_ROUGH);
+        }
+    }
+}
+
+// Smoothed value noise thresholded at the density percentile, which gives the
+// lakes, ridges and chokepoints of a generated map rather than scattered single cells
+void fill_seeded(FlowGrid &grid, int density, uint32_t seed) {
+    const int width = grid.width;
+    const int height = grid.height;
+    const int lattice = 16;
+    const int lattice_w = width / lattice + 2;
+    const int lattice_h = height / lattice + 2;
+
+    uint32_t state = seed;
+    std::vector<float> corners(static_cast<size_t>(lattice_w) * lattice_h);
+    for (float &corner : corners) {
+        corner = (next_random(state) & 0xFFFF) / 65535.0f;
+    }
+
+    std::vector<float> noise(static_cast<size_t>(width) * height);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            float fx = static_cast<float>(x) / lattice;
+            float fy = static_cast<float>(y) / lattice;
+            int lx = static_cast<int>(fx);
+            int ly = static_cast<int>(fy);
+            float tx = fx - lx;
+            float ty = fy - ly;
+            tx = tx * tx * (3.0f - 2.0f * tx);
+            ty = ty * ty * (3.0f - 2.0f * ty);
+
+            float a = corners[ly * lattice_w + lx];
+            float b = corners[ly * lattice_w + lx + 1];
+            float c = corners[(ly + 1) * lattice_w + lx];
+            float d = corners[(ly + 1) * lattice_w + lx + 1];
+            noise[y * width + x] = (a + (b - a) * tx) + ((c + (d - c) * tx) - (a + (b - a) * tx)) * ty;
+        }
+    }
+
+    // Highest noise becomes obstacle, the band just below it rough slope
+    std::vector<float> sorted = noise;
+    std::sort(sorted.begin(), sorted.end());
+    const size_t cell_count = sorted.size();
+    float blocked_above = sorted[std::min(cell_count - 1, cell_count * (100 - density) / 100)];
+    float rough_above = sorted[std::min(cell_count - 1, cell_count * std::max(0, 80 - density) / 100)];
+
+    for (size_t i = 0; i < cell_count; i++) {
+        if (density > 0 && noise[i] >= blocked_above) {
+            block_cell(grid, static_cast<int>(i));
+        } else if (noise[i] >= rough_above) {
+            grid.set_cost(static_cast<int>(i), FLOW_COST_ROUGH);
+        }
+    }
+}
+
+// Open cell nearest the centre, so every map has a usable goal
+int find_goal(const FlowGrid &grid) {
+    const int cx = grid.width / 2;
+    const int cy = grid.height / 2;
+    for (int radius = 0; radius < std::max(grid.width, grid.height); radius++) {
+        for (int y = std::max(cy - radius, 0); y <= std::min(cy + radius, grid.height - 1); y++) {
+            for (int x = std::max(cx - radius, 0); x <= std::min(cx + radius, grid.width - 1); x++) {
+                if (grid.is_walkable(y * grid.width + x)) {
+                    return y * grid.width + x;
+                }
+            }
+        }
+    }
+    return -1;
+}
+
+size_t get_peak_memory_bytes() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+// One full field: integration, line of sight and directions, as FlowFieldManager builds it
+BenchResult run_case(const FlowGrid &grid, IntegrationEngine engine, int iterations) {
+    BenchResult result;
+    const size_t cell_count = static_cast<size_t>(grid.width) * grid.height;
+    std::vector<int> targets(1, find_goal(grid));
+    std::vector<int> no_stops;
+    std::vector<CellRect> regions(1, CellRect{0, 0, grid.width, grid.height});
+
+    std::vector<float> integration;
+    std::vector<uint8_t> directions(cell_count, FLOW_DIR_NONE);
+    std::vector<uint64_t> los_bits;
+
+    double total_ms = 0.0;
+    result.min_ms = 1e30;
+    for (int i = 0; i < iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        integration.assign(cell_count, FLT_MAX);
+        if (engine == IntegrationEngine::DIAL_BUCKETS) {
+            integrate_dial(grid, grid.walkable_bits, integration, targets, no_stops, 0.0f);
+        } else {
+            integrate_heap(grid, grid.walkable_bits, integration, targets, no_stops, 0.0f);
+        }
+        compute_line_of_sight(grid, grid.walkable_bits, targets[0], los_bits);
+        build_directions(grid, grid.walkable_bits, integration, directions, regions);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        total_ms += ms;
+        result.min_ms = std::min(result.min_ms, ms);
+    }
+
+    result.engine = engine == IntegrationEngine::DIAL_BUCKETS ? "dial" : "heap";
+    result.mean_ms = total_ms / iterations;
+    result.cells_per_sec = result.mean_ms > 0.0 ? cell_count / (result.mean_ms / 1000.0) : 0.0;
+    result.reached_cells = static_cast<size_t>(std::count_if(integration.begin(), integration.end(), [](float value) {
+        return value != FLT_MAX;
+    }));
+    result.field_bytes = integration.capacity() * sizeof(float) + directions.capacity() + los_bits.capacity() * sizeof(uint64_t);
+    return result;
+}
+
+// Smoothed A* from reachable cells at least a quarter of the map away to the field goal;
+// mean_ms is per path, reached_cells the mean smoothed point count, and crossover_units
+// the field time over the path time
+BenchResult run_path_case(const FlowGrid &grid, double field_ms, const BenchOptions &options) {
+    const int iterations = options.iterations;
+    BenchResult result;
+    result.engine = "astar";
+    const size_t cell_count = static_cast<size_t>(grid.width) * grid.height;
+    const int goal = find_goal(grid);
+    std::vector<int> targets(1, goal);
+    std::vector<int> no_stops;
+    std::vector<float> integration(cell_count, FLT_MAX);
+    integrate_dial(grid, grid.walkable_bits, integration, targets, no_stops, 0.0f);
+    
+    const int min_distance = std::max(grid.width, grid.height) / 4;
+    std::vector<int> starts;
+    uint32_t state = options.seed ^ 0x9E3779B9u;
+    for (int attempt = 0; attempt < PATH_STARTS * 64 && static_cast<int>(starts.size()) < PATH_STARTS; attempt++) {
+        int index = static_cast<int>(next_random(state) % cell_count);
+        int distance = std::max(std::abs(index % grid.width - goal % grid.width), std::abs(index / grid.width - goal / grid.width));
+        if (integration[index] != FLT_MAX && distance >= min_distance) {
+            starts.push_back(index);
+        }
+    }
+    if (starts.empty()) {
+        return result;
+    }
+    
+    PathScratch scratch;
+    std::vector<int> path;
+    size_t path_cells = 0;
+    double total_ms = 0.0;
+    result.min_ms = 1e30;
+    for (int i = 0; i < iterations; i++) {
+        for (int start : starts) {
+            auto begin = std::chrono::steady_clock::now();
+            find_path_astar(grid, grid.walkable_bits, start, goal, scratch, path, options.path_weight);
+            smooth_path(grid, grid.walkable_bits, path);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+            
+            total_ms += ms;
+            result.min_ms = std::min(result.min_ms, ms);
+            path_cells += path.size();
+        }
+    }
+    
+    const size_t runs = static_cast<size_t>(iterations) * starts.size();
+    result.mean_ms = total_ms / runs;
+    result.cells_per_sec = result.mean_ms > 0.0 ? cell_count / (result.mean_ms / 1000.0) : 0.0;
+    result.reached_cells = path_cells / runs;
+    result.field_bytes = scratch.memory_usage();
+    result.crossover_units = result.mean_ms > 0.0 ? field_ms / result.mean_ms : 0.0;
+    return result;
+}
+
+// Quotes, backslashes and control characters escaped for a JSON string
+std::string json_escape(const std::string &text) {
+    std::string out;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char code[8];
+            std::snprintf(code, sizeof(code), "\\u%04x", c);
+            out += code;
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+bool write_json(const BenchOptions &options, const std::vector<BenchResult> &results, size_t peak_bytes) {
+    FILE *file = std::fopen(options.json_path.c_str(), "w");
+    if (!file) {
+        std::fprintf(stderr, "flow_field_bench: could not write %s\n", options.json_path.c_str());
+        return false;
+    }
+
+    std::fprintf(file, "{\n  \"label\": \"%s\",\n  \"seed\": %u,\n  \"iterations\": %d,\n  \"path_weight\": %.2f,\n  \"peak_memory_bytes\": %zu,\n  \"results\": [\n",
+            json_escape(options.label).c_str(), options.seed, options.iterations, options.path_weight, peak_bytes);
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult &r = results[i];
+        std::fprintf(file, "    {\"map\": \"%s\", \"size\": %d, \"density\": %d, \"engine\": \"%s\", \"mean_ms\": %.4f, \"min_ms\": %.4f, "
+                "\"cells_per_sec\": %.0f, \"reached_cells\": %zu, \"field_bytes\": %zu, \"crossover_units\": %.1f}%s\n",
+                r.map, r.size, r.density, r.engine, r.mean_ms, r.min_ms, r.cells_per_sec, r.reached_cells, r.field_bytes,
+                r.crossover_units, i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(file, "  ]\n}\n");
+    std::fclose(file);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (!std::strcmp(argv[i], "--sizes") && has_value) {
+            options.sizes = parse_list(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--densities") && has_value) {
+            options.densities = parse_list(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--iterations") && has_value) {
+            options.iterations = std::max(1, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--seed") && has_value) {
+            options.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (!std::strcmp(argv[i], "--path-weight") && has_value) {
+            options.path_weight = std::max(1.0f, static_cast<float>(std::atof(argv[++i])));
+        } else if (!std::strcmp(argv[i], "--json") && has_value) {
+            options.json_path = argv[++i];
+        } else if (!std::strcmp(argv[i], "--label") && has_value) {
+            options.label = argv[++i];
+        } else {
+            std::fprintf(stderr, "usage: %s [--sizes 64,128,...] [--densities 0,10,...] [--iterations N] [--seed N] [--path-weight W] [--json path] [--label text]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<BenchResult> results;
+    std::printf("%-9s %5s %4s %-5s %10s %10s %14s %10s %9s\n", "map", "size", "obst", "eng", "mean_ms", "min_ms", "cells/s", "reached", "crossover");
+
+    const char *maps[] = {"synthetic", "seeded"};
+    for (const char *map : maps) {
+        for (int size : options.sizes) {
+            for (int density : options.densities) {
+                FlowGrid grid;
+                grid.resize(size, size);
+                if (map == maps[0]) {
+                    fill_synthetic(grid, density, options.seed);
+                } else {
+                    fill_seeded(grid, density, options.seed);
+                }
+
+                // Paths are measured against the faster engine, which is what the game uses
+                double field_ms = 0.0;
+                for (int engine = 0; engine < 3; engine++) {
+                    BenchResult result = engine == 2 ? run_path_case(grid, field_ms, options)
+                            : run_case(grid, engine == 0 ? IntegrationEngine::DIJKSTRA_HEAP : IntegrationEngine::DIAL_BUCKETS, options.iterations);
+                    result.map = map;
+                    result.size = size;
+                    result.density = density;
+                    results.push_back(result);
+                    if (engine == 1) {
+                        field_ms = result.mean_ms;
+                    }
+
+                    std::printf("%-9s %5d %3d%% %-5s %10.3f %10.3f %14.0f %10zu", map, size, density, result.engine,
+                            result.mean_ms, result.min_ms, result.cells_per_sec, result.reached_cells);
+                    if (engine == 2) {
+                        std::printf(" %8.1fx", result.crossover_units);
+                    }
+                    std::printf("\n");
+                }
+            }
+        }
+    }
+
+    size_t peak_bytes = get_peak_memory_bytes();
+    std::printf("peak memory: %.1f MB\n", peak_bytes / (1024.0 * 1024.0));
+
+    if (!options.json_path.empty() && !write_json(options, results, peak_bytes)) {
+        return 1;
+    }
+    return 0;
+}
@@ -87,6 +87,7 @@ private:
     // Unit spawning
     godot::Vector3 spawn_point;
     godot::Vector3 rally_point;
+    int rally_field_id = -1;              // Pinned flow field toward the rally point (-1 = none)
     
     // Training queue
     int unit_queue = 0;
@@ -149,6 +150,7 @@ public:
     godot::Vector3 get_spawn_point() const;
     godot::Vector3 get_rally_point() const;
     void set_rally_point(const godot::Vector3 &point);
+    void register_flow_field_targets() override;
     
     // Getters
     int get_unit_queue() const;
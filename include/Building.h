@@ -12,8 +12,12 @@
 #include <godot_cpp/classes/collision_shape3d.hpp>
 #include <godot_cpp/core/class_db.hpp>
 
+#include <vector>
+
 namespace rts {
 
+class FlowFieldManager;
+
 class Building : public godot::StaticBody3D {
     GDCLASS(Building, godot::StaticBody3D)
 
@@ -53,12 +57,20 @@ protected:
     
     // Flag for subclasses that create their own geometry
     bool skip_default_mesh = false;
+    
+    // Static flow field targets pinned for this building; released when it leaves the tree
+    FlowFieldManager *flow_field_manager = nullptr;
+    std::vector<int> static_target_ids;
+    int pin_static_target(const godot::Vector3 &position, int footprint_class);
+    void unpin_static_target(int field_id);
+    void unpin_static_targets();
 
 public:
     Building();
     ~Building();
 
     void _ready() override;
+    void _exit_tree() override;
     void _process(double delta) override;
     
     // Setup
@@ -116,6 +128,7 @@ public:
     bool get_preview_mode() const;
     void update_preview_visual();
     void notify_flow_field_of_placement();
+    virtual void register_flow_field_targets();
     static bool is_position_valid_for_building(godot::Node *context, const godot::Vector3 &position, float size, uint32_t check_mask);
 
     // Signals
@@ -159,6 +159,7 @@ public:
     void update_bulldozer_production(double delta);
     godot::Vector3 get_spawn_point() const;
     godot::Vector3 get_rally_point() const;
+    void register_flow_field_targets() override;
     
     // Getters
     int get_bulldozer_queue() const;
@@ -0,0 +1,175 @@
+/**
+ * CrowdSystem.h
+ * Batched movement for every Unit in the scene.
+ * Per-agent state lives in contiguous arrays; a Unit holds its orders and a slot index.
+ */
+
+#ifndef CROWD_SYSTEM_H
+#define CROWD_SYSTEM_H
+
+#include <godot_cpp/classes/node.hpp>
+#include <godot_cpp/classes/mesh_instance3d.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace rts {
+
+class Unit;
+class SpatialHash;
+class FlowFieldManager;
+class TerrainGenerator;
+
+enum AvoidanceMode {
+    AVOIDANCE_STEERING = 0,   // Forward ray, 8-way clear-direction search and separation push
+    AVOIDANCE_ORCA = 1        // Reciprocal velocity obstacles; no raycasts
+};
+
+class CrowdSystem : public godot::Node {
+    GDCLASS(CrowdSystem, godot::Node)
+
+private:
+    // Steering settings shared by all agents
+    float acceleration = 15.0f;
+    float deceleration = 20.0f;
+    float turn_rate = 5.0f;               // How quickly units turn to face their velocity
+    float arrival_threshold = 0.5f;
+    float avoidance_radius = 5.0f;        // How far ahead to look for obstacles
+    float separation_radius = 1.2f;       // Minimum distance from other units
+    float separation_strength = 10.0f;    // How strongly to separate from other units
+    
+    // ORCA avoidance
+    AvoidanceMode avoidance_mode = AVOIDANCE_STEERING;
+    float orca_time_horizon = 2.0f;       // Seconds ahead that neighbour collisions are ruled out
+    float orca_neighbor_distance = 4.0f;  // Neighbours and buildings further than this are ignored
+    
+    // Terrain following
+    float uphill_speed_multiplier = 0.5f;
+    float downhill_speed_multiplier = 1.4f;
+    
+    // Walking animation
+    float walk_bob_amount = 0.08f;
+    float walk_bob_speed = 12.0f;
+    float walk_sway_amount = 0.02f;
+    
+    // Per-agent state; slot i belongs to units[i], removal swaps the last slot in
+    enum AgentFlags : uint8_t {
+        AGENT_HAS_ORDER = 1,
+        AGENT_AVOIDING = 2,
+        AGENT_SYNC_POSITION = 4,          // Node was placed externally; read its position next pass
+        AGENT_MOVED = 8,                  // Transform needs writing back
+        AGENT_POSED = 16,                 // Mesh is away from its rest pose
+        AGENT_ARRIVED = 32                // Set by the steering phase, consumed when applying
+    };
+    std::vector<Unit *> units;
+    std::vector<godot::MeshInstance3D *> meshes;
+    std::vector<godot::Vector3> positions;
+    std::vector<godot::Vector3> velocities;
+    std::vector<godot::Vector3> targets;
+    std::vector<godot::Vector3> flow_vectors;
+    std::vector<float> base_speeds;
+    std::vector<float> speeds;            // Base speed after the slope adjustment
+    std::vector<float> headings;          // Yaw in radians
+    std::vector<float> walk_times;
+    std::vector<uint8_t> flags;
+    
+    // Steering phase outputs, one per agent
+    std::vector<godot::Vector3> desired_directions;     // After obstacle avoidance and separation in Steering mode
+    std::vector<godot::Vector3> avoidance_velocities;   // ORCA mode only
+    bool use_threaded_steering = true;   // Steer in chunks on WorkerThreadPool; movement is still applied serially
+    float steering_delta = 1.0f / 60.0f;
+    
+    // Arrivals found during the pass; handled afterwards since they call back into Unit
+    std::vector<Unit *> arrivals;
+    
+    // Cached references, resolved once in _ready
+    SpatialHash *spatial_hash = nullptr;
+    FlowFieldManager *flow_field_manager = nullptr;
+    TerrainGenerator *terrain = nullptr;
+    
+    float last_update_ms = 0.0f;
+    
+    void run_steering_phase(int max_workers);
+    void steer_agent(int index);
+    godot::Vector3 steer_around_obstacles(int index, const godot::Vector3 &desired_direction);
+    void apply_agent(int index, float delta);
+    void apply_steering(int index, float delta);
+    godot::Vector3 solve_orca_velocity(int index, const godot::Vector3 &preferred_velocity) const;
+    void integrate_agent(int index, float delta);
+    void snap_agent_to_terrain(int index, float delta);
+    void animate_agent(int index, float delta);
+    godot::Vector3 separation_force(int index) const;
+    godot::Vector3 find_clear_direction(int index, const godot::Vector3 &preferred_dir) const;
+    float obstacle_clearance(const godot::Vector3 &position, const godot::Vector3 &direction) const;   // Traced through the nav grid's distance field
+
+protected:
+    static void _bind_methods();
+
+public:
+    CrowdSystem();
+    ~CrowdSystem();
+    
+    void _ready() override;
+    void _physics_process(double delta) override;
+    
+    // Agents
+    int add_agent(Unit *unit);
+    void remove_agent(int index);
+    int get_agent_count() const;
+    
+    void update_agents(double delta);
+    void _steer_chunk(int chunk);
+    godot::Dictionary benchmark_steering(int iterations);
+    
+    // Slot access for Unit
+    godot::Vector3 get_agent_velocity(int index) const { return velocities[index]; }
+    void set_agent_velocity(int index, const godot::Vector3 &velocity) { velocities[index] = velocity; }
+    godot::Vector3 get_agent_target(int index) const { return targets[index]; }
+    void set_agent_target(int index, const godot::Vector3 &target) { targets[index] = target; }
+    void set_agent_flow_vector(int index, const godot::Vector3 &vector) { flow_vectors[index] = vector; }
+    bool get_agent_has_order(int index) const { return flags[index] & AGENT_HAS_ORDER; }
+    void set_agent_has_order(int index, bool has_order);
+    void set_agent_base_speed(int index, float speed);
+    
+    // Getters/Setters
+    void set_acceleration(float value);
+    float get_acceleration() const;
+    
+    void set_deceleration(float value);
+    float get_deceleration() const;
+    
+    void set_turn_rate(float value);
+    float get_turn_rate() const;
+    
+    void set_arrival_threshold(float value);
+    float get_arrival_threshold() const;
+    
+    void set_avoidance_radius(float value);
+    float get_avoidance_radius() const;
+    
+    void set_separation_radius(float value);
+    float get_separation_radius() const;
+    
+    void set_separation_strength(float value);
+    float get_separation_strength() const;
+    
+    void set_avoidance_mode(int mode);
+    int get_avoidance_mode() const;
+    
+    void set_orca_time_horizon(float seconds);
+    float get_orca_time_horizon() const;
+    
+    void set_orca_neighbor_distance(float distance);
+    float get_orca_neighbor_distance() const;
+    
+    void set_use_threaded_steering(bool enabled);
+    bool get_use_threaded_steering() const;
+    
+    float get_last_update_ms() const;
+};
+
+} // namespace rts
+
+#endif // CROWD_SYSTEM_H
@@ -0,0 +1,162 @@
+/**
+ * FlowFieldCore.h
+ * Godot-free flow field data and kernels, shared by FlowFieldManager and the benchmark.
+ */
+
+#ifndef FLOW_FIELD_CORE_H
+#define FLOW_FIELD_CORE_H
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace rts {
+
+// Packed 8-way direction index; FLOW_DIR_NONE marks the goal and unreachable cells
+static constexpr uint8_t FLOW_DIR_COUNT = 8;
+static constexpr uint8_t FLOW_DIR_NONE = 8;
+
+// Cell traversal cost multiplier; FLOW_COST_IMPASSABLE is stored for blocked cells
+static constexpr uint8_t FLOW_COST_DEFAULT = 1;
+static constexpr uint8_t FLOW_COST_ROUGH = 2;
+static constexpr uint8_t FLOW_COST_IMPASSABLE = 255;
+
+// Integration pass used to fill a field's integration array
+enum class IntegrationEngine {
+    DIJKSTRA_HEAP = 0,   // Binary heap with lazy deletion
+    DIAL_BUCKETS = 1     // Circular bucket queue over quantized edge weights
+};
+
+/**
+ * Walkability/cost grid shared by every cached field.
+ * Cost is one byte per cell, walkability one bit per cell.
+ */
+struct FlowGrid {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> costs;
+    std::vector<uint64_t> walkable_bits;
+    uint8_t max_cost = FLOW_COST_DEFAULT;    // Upper bound of passable costs (sizes the bucket queue)
+    
+    void resize(int w, int h);
+    
+    void set_cost(int index, uint8_t cost) {
+        costs[index] = cost;
+        if (cost != FLOW_COST_IMPASSABLE && cost > max_cost) {
+            max_cost = cost;
+        }
+    }
+    
+    bool is_walkable(int index) const {
+        return (walkable_bits[index >> 6] >> (index & 63)) & 1u;
+    }
+    
+    void set_walkable(int index, bool walkable) {
+        uint64_t bit = uint64_t(1) << (index & 63);
+        if (walkable) {
+            walkable_bits[index >> 6] |= bit;
+        } else {
+            walkable_bits[index >> 6] &= ~bit;
+        }
+    }
+    
+    size_t memory_usage() const;
+};
+
+// Half-open cell rectangle [x0, x1) x [y0, y1)
+struct CellRect {
+    int x0 = 0;
+    int y0 = 0;
+    int x1 = 0;
+    int y1 = 0;
+    
+    bool is_empty() const { return x1 <= x0 || y1 <= y0; }
+    bool contains(int x, int y) const { return x >= x0 && x < x1 && y >= y0 && y < y1; }
+};
+
+// 8-directional neighbors (including diagonals), indexed by packed direction
+static constexpr int FLOW_DX[FLOW_DIR_COUNT] = {-1, 0, 1, -1, 1, -1, 0, 1};
+static constexpr int FLOW_DY[FLOW_DIR_COUNT] = {-1, -1, -1, 0, 0, 1, 1, 1};
+static constexpr float FLOW_STEP_COST[FLOW_DIR_COUNT] = {1.414f, 1.0f, 1.414f, 1.0f, 1.0f, 1.414f, 1.0f, 1.414f};
+
+// Edge weights quantized to tenths of a cell for the bucket queue
+static constexpr uint32_t FLOW_STEP_COST_FIXED[FLOW_DIR_COUNT] = {14, 10, 14, 10, 10, 14, 10, 14};
+static constexpr float FLOW_FIXED_SCALE = 10.0f;
+static constexpr float FLOW_STEP_COST_QUANTIZED[FLOW_DIR_COUNT] = {1.4f, 1.0f, 1.4f, 1.0f, 1.0f, 1.4f, 1.0f, 1.4f};
+
+inline bool neighbor_in_bounds(const FlowGrid &grid, int x, int y, int dir) {
+    int nx = x + FLOW_DX[dir];
+    int ny = y + FLOW_DY[dir];
+    return nx >= 0 && nx < grid.width && ny >= 0 && ny < grid.height;
+}
+
+inline bool is_bit_set(const std::vector<uint64_t> &bits, int index) {
+    return (bits[index >> 6] >> (index & 63)) & 1u;
+}
+
+// Integration kernels; both fill `integration` (pre-filled with FLT_MAX) from every target
+// and return the settle limit, FLT_MAX when the search ran to completion
+float integrate_heap(const FlowGrid &grid, const std::vector<uint64_t> &passable, std::vector<float> &integration, const std::vector<int> &targets,
+        const std::vector<int> &stop_cells, float stop_margin);
+float integrate_dial(const FlowGrid &grid, const std::vector<uint64_t> &passable, std::vector<float> &integration, const std::vector<int> &targets,
+        const std::vector<int> &stop_cells, float stop_margin);
+
+// Direction extraction over settled integration values
+uint8_t compute_cell_direction(const FlowGrid &grid, const std::vector<uint64_t> &passable,
+        const std::vector<float> &integration, int x, int y);
+void build_directions(const FlowGrid &grid, const std::vector<uint64_t> &passable, const std::vector<float> &integration,
+        std::vector<uint8_t> &directions, const std::vector<CellRect> &regions);
+
+// One bit per cell that can steer straight at the target
+void compute_line_of_sight(const FlowGrid &grid, const std::vector<uint64_t> &passable, int target_index,
+        std::vector<uint64_t> &los);
+
+// Default A* heuristic weight: paths cost at most 20% over optimal while expanding an order of magnitude fewer cells
+static constexpr float PATH_HEURISTIC_WEIGHT = 1.2f;
+
+// Default A* expansion budget (about a millisecond); harder searches are left to a flow field
+static constexpr int PATH_MAX_EXPANSIONS = 8192;
+
+/**
+ * Reusable A* buffers. Cells are stamped with the search generation instead of
+ * being cleared, so a short search costs nothing proportional to the map size.
+ */
+struct PathScratch {
+    // Interleaved so a neighbour check touches one cache line
+    struct Node {
+        float cost = FLT_MAX;
+        int parent = -1;
+        uint32_t generation = 0;    // Search that last reached this cell
+        uint32_t closed = 0;        // Search that last expanded it
+    };
+    std::vector<Node> nodes;
+    uint32_t generation = 0;
+    
+    struct OpenEntry {
+        float f;
+        float h;
+        int index;
+    };
+    std::vector<OpenEntry> open;
+    
+    size_t memory_usage() const;
+};
+
+// True if every cell on the segment is passable with cost <= max_cost
+// (FLOW_COST_IMPASSABLE accepts any passable cell); diagonal squeezes between blocked corners fail
+bool segment_clear(const FlowGrid &grid, const std::vector<uint64_t> &passable, int from, int to, uint8_t max_cost);
+
+// Grid A* with the integration step costs and an octile heuristic; fills `path`
+// with cell indices from start to goal inclusive and returns false if unreachable or if more
+// than max_expansions cells (0 = no limit) were expanded. A heuristic weight above 1 expands
+// far fewer cells for paths at most that factor longer
+bool find_path_astar(const FlowGrid &grid, const std::vector<uint64_t> &passable, int start, int goal,
+        PathScratch &scratch, std::vector<int> &path, float heuristic_weight = 1.0f, int max_expansions = 0);
+
+// String pulling: drops path cells while the shortcut stays clear and no costlier than the cells it replaces
+void smooth_path(const FlowGrid &grid, const std::vector<uint64_t> &passable, std::vector<int> &path);
+
+} // namespace rts
+
+#endif // FLOW_FIELD_CORE_H
@@ -2,27 +2,107 @@
  * FlowFieldManager.h
  * Grid-based pathfinding using Dijkstra flow field algorithm.
  * Computes direction vectors for each cell toward a target.
+ * Fields are cached per goal and kept valid as walkability changes.
  */
 
 #ifndef FLOW_FIELD_MANAGER_H
 #define FLOW_FIELD_MANAGER_H
 
+#include "FlowFieldCore.h"
+
 #include <godot_cpp/classes/node3d.hpp>
 #include <godot_cpp/templates/vector.hpp>
 #include <godot_cpp/templates/hash_map.hpp>
 #include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/packed_vector3_array.hpp>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <queue>
+#include <unordered_map>
 #include <vector>
 
 namespace rts {
 
-struct FlowCell {
-    int x = 0;
-    int y = 0;
-    float cost = 1.0f;
-    float distance = std::numeric_limits<float>::max();
-    godot::Vector3 direction = godot::Vector3(0, 0, 0);
-    bool walkable = true;
+class TerrainGenerator;
+
+// Unit size class; each class gets its own fields with its clearance threshold applied
+enum class FootprintClass {
+    INFANTRY = 0,
+    LIGHT_VEHICLE = 1,
+    HEAVY_VEHICLE = 2
+};
+static constexpr int FOOTPRINT_CLASS_COUNT = 3;
+
+// Square building base blocking the cells under it
+struct BuildingFootprint {
+    godot::Vector3 position;
+    float size = 0.0f;
+};
+
+// Side of the coarse world buckets footprints are indexed in for proximity queries
+static constexpr float FOOTPRINT_BUCKET_SIZE = 16.0f;
+
+/**
+ * One side of a sector border crossing in the abstract graph.
+ * Each entrance yields a node on both sides, linked by a crossing edge.
+ */
+struct PortalNode {
+    int cell = -1;                              // Cell index on this side of the border
+    int sector = -1;
+    int slot = -1;                              // Index within its sector's node list
+    std::vector<std::pair<int, float>> edges;   // (node id, cost) crossing into the neighbor sector
+};
+
+/**
+ * Integration and direction data for a single goal cell.
+ * Arrays are row-major (index = y * grid_width + x).
+ */
+struct FlowField {
+    int id = -1;
+    godot::Vector2i goal_cell;               // First goal (the only one for single-goal fields)
+    std::vector<int> goal_indices;           // Every seeded goal cell index
+    godot::Vector3 target;                   // World position of the order that built it
+    std::vector<float> integration;          // Accumulated cost to the goal (FLT_MAX = unreachable)
+    std::vector<uint8_t> directions;         // Packed 8-way direction index per cell
+    std::vector<uint8_t> sector_mask;        // Sectors the field was integrated over (empty = whole grid)
+    std::vector<uint64_t> los_bits;          // Cells with an unobstructed straight line to the goal
+    CellRect window;                         // Cells the field was integrated over (empty = unbounded)
+    int window_padding = 0;                  // Cells of margin around starts and goal in the window
+    std::vector<int> start_cells;            // Unit cells the window has to reach
+    float settle_limit = FLT_MAX;            // Integration stopped past this value (FLT_MAX = every reachable cell settled)
+    int pin_count = 0;                       // Static target registrations; pinned fields are never evicted
+    std::vector<int> deferred_changes;       // Walkability changes not yet repaired into a pinned field
+    bool needs_rebuild = false;              // Too many deferred changes; re-integrate on next use
+    std::vector<int> congestion_changes;     // Congestion cost changes not yet repaired in
+    uint64_t congestion_repair_usec = 0;     // When congestion was last repaired in
+    IntegrationEngine engine = IntegrationEngine::DIAL_BUCKETS;  // Step costs used by integration (for repair)
+    FootprintClass footprint_class = FootprintClass::INFANTRY;
+    int pending_job = -1;                    // Background job building the next buffer (-1 = none)
+    std::list<int>::iterator lru_position;   // Position in the LRU list (front = most recent)
+    
+    size_t memory_usage() const;
+};
+
+/**
+ * Background integration of one field.
+ * The worker only touches the job's own snapshot, so the live grid can change while it runs.
+ */
+struct FlowFieldJob {
+    int field_id = -1;
+    int64_t task_id = -1;
+    FlowGrid grid;                           // Cost snapshot; walkability is baked into passable
+    std::vector<uint64_t> passable;
+    std::vector<CellRect> regions;
+    FlowField result;
+    size_t change_log_offset = 0;            // Walkability changes from here on landed mid-build
+    bool line_of_sight = false;
+    float termination_margin = 0.0f;         // Cost settled past the last start cell
+    uint64_t requested_usec = 0;
 };
 
 class FlowFieldManager : public godot::Node3D {
@@ -35,22 +115,105 @@ private:
     float cell_size = 2.0f;
     godot::Vector3 grid_origin;
     
-    // Flow field data
-    std::vector<std::vector<FlowCell>> grid;
-    bool field_computed = false;
+    // Walkability/cost grid; flat row-major arrays (index = y * grid_width + x)
+    FlowGrid grid;
+    
+    // Sector/portal layer; integration is limited to the sectors on the route to the goal
+    bool use_hierarchical_search = true;
+    int sector_size = 32;
+    int sector_cols = 0;
+    int sector_rows = 0;
+    std::vector<PortalNode> portal_nodes;
+    std::vector<std::vector<int>> sector_nodes;         // sector -> portal node ids
+    std::vector<std::vector<float>> sector_edge_costs;  // sector -> k x k node-to-node costs (FLT_MAX = unreachable)
+    std::vector<uint8_t> sector_edges_ready;            // Intra-sector costs are built on first use
+    std::vector<uint8_t> sector_cells_dirty;            // Walkability changed since the last rebuild
+    bool portal_graph_dirty = true;
+    
+    // Flow field cache (keyed by goal cell, LRU ordered)
+    std::unordered_map<int, FlowField> field_cache;     // field id -> field
+    std::unordered_map<int, int> field_by_goal;         // goal key (cell, footprint class) -> field id
+    std::map<std::vector<int>, int> field_by_goal_set;  // sorted goal cells + footprint class -> multi-goal field id
+    std::list<int> lru_order;                           // field ids, most recently used first
+    size_t cache_memory_usage = 0;
+    float cache_budget_mb = 32.0f;
+    int next_field_id = 0;
+    IntegrationEngine integration_engine = IntegrationEngine::DIAL_BUCKETS;
+    bool use_line_of_sight = true;                      // Cells that see the goal steer straight at it
+    
+    // Windowed integration for short orders
+    bool use_windowed_search = true;
+    int window_padding = 16;                            // Initial margin in cells; doubled while a start is cut off
+    bool use_early_termination = true;
+    float termination_margin = 8.0f;                    // Cost settled past the farthest start before stopping
+    
+    // Fields are integrated on WorkerThreadPool and swapped in on the main thread when ready
+    bool use_threaded_computation = true;
+    std::unordered_map<int, std::unique_ptr<FlowFieldJob>> flow_field_jobs;   // job id -> job
+    std::mutex job_mutex;                               // Guards flow_field_jobs against worker lookups
+    int next_job_id = 0;
+    std::vector<int> walkability_change_log;            // Cells changed while jobs are in flight
+    float last_field_latency_ms = 0.0f;
+    float average_field_latency_ms = 0.0f;
+    
+    // Field used by the legacy single-target API (compute_flow_field/get_flow_direction)
+    int current_field_id = -1;
     godot::Vector3 current_target;
     
     // Terrain reference
-    godot::Node *terrain_generator = nullptr;
+    TerrainGenerator *terrain_generator = nullptr;
     
     // Terrain sampling
-    float terrain_sample_height = 100.0f;
     uint32_t ground_collision_layer = 1;
-    uint32_t obstacle_collision_layer = 0b1110; // Units(2), Buildings(4), Vehicles(8)
+    std::vector<uint8_t> terrain_costs;                 // Cost from the heightmap alone (FLOW_COST_IMPASSABLE = cliff/water)
+    std::vector<BuildingFootprint> building_footprints; // Stamped over terrain_costs as unwalkable
+    std::unordered_map<int64_t, std::vector<int>> footprint_buckets;  // Footprint indices by the bucket holding their centre
+    float max_footprint_half_size = 0.0f;
+    
+    static int64_t footprint_bucket_key(int x, int z) {
+        return (static_cast<int64_t>(x) << 32) | static_cast<uint32_t>(z);
+    }
+    static int footprint_bucket_coord(float value) {
+        return static_cast<int>(std::floor(value / FOOTPRINT_BUCKET_SIZE));
+    }
+    
+    // Clearance per footprint class; wide units get fields that skip gaps they cannot fit through
+    float footprint_radius[FOOTPRINT_CLASS_COUNT] = {0.4f, 1.5f, 3.0f};
+    std::vector<uint8_t> clearance;                     // Chebyshev cells to the nearest blocked cell (capped)
+    std::vector<uint64_t> class_walkable_bits[FOOTPRINT_CLASS_COUNT];  // Infantry uses grid.walkable_bits
+    std::vector<float> obstacle_distance;               // Signed world distance from each cell centre to the nearest blocked edge (capped)
     
     // Terrain walkability thresholds
     float max_walkable_slope = 0.7f;      // Maximum slope angle (0-1, 1 = vertical)
     float max_height_difference = 2.0f;    // Maximum height diff between adjacent cells
+    float slope_cost_scale = 2.0f;         // Extra cell cost per unit of grade (rise over run)
+    
+    // Congestion layer (decayed unit counts added to cell costs)
+    bool use_density_costs = true;
+    float density_update_interval = 0.25f;              // Seconds between splats
+    float density_decay = 0.5f;                         // Fraction of the density kept per update
+    float density_cost_scale = 0.5f;                    // Extra cell cost per unit of density
+    int max_density_cost = 8;
+    float congestion_repair_interval = 1.0f;            // Minimum seconds between congestion repairs of one field
+    float density_timer = 0.0f;
+    std::vector<float> density;                         // Decayed unit count per cell
+    std::vector<uint8_t> congestion_costs;              // Extra cost currently folded into grid.costs
+    std::vector<int> density_cells;                     // Cells with non-zero density
+    bool congestion_lifted = false;                     // grid.costs temporarily hold terrain costs only
+    
+    // Static targets: pinned full-grid fields, repaired on next use and cached on disk per map seed
+    std::vector<int> static_field_ids;
+    bool persist_static_fields = true;
+    godot::String static_field_directory = "user://flow_fields";
+    
+    // Single-unit paths
+    int path_unit_threshold = 4;                        // Orders for up to this many units use A* (0 = always fields)
+    float path_heuristic_weight = PATH_HEURISTIC_WEIGHT;
+    int path_max_expansions = PATH_MAX_EXPANSIONS;      // Harder searches fall back to a field (0 = unlimited)
+    PathScratch path_scratch;
+    std::vector<int> path_cells;
+    int walkability_version = 0;                        // Bumped on every walkability change so paths can replan
+    float last_path_time_ms = 0.0f;
     
     // Debug
     bool debug_draw = false;
@@ -64,20 +227,124 @@ public:
 
     void _ready() override;
     void _process(double delta) override;
+    void _exit_tree() override;
 
     // Grid management
     void initialize_grid();
     void update_walkability();
     void refresh_walkability_area(const godot::Vector3 &center, float radius);
     void mark_building_area(const godot::Vector3 &position, float size, bool walkable);
+    void sample_terrain(const CellRect &area);
+    void apply_walkability(const CellRect &area, std::vector<int> *changed_cells);
+    CellRect get_footprint_rect(const BuildingFootprint &footprint) const;
+    CellRect clamp_to_grid(const CellRect &rect) const;
+    int get_building_footprint_count() const;
+    const std::vector<BuildingFootprint> &get_building_footprints() const;
+    void rebuild_footprint_buckets();
+    
+    // Calls callback(footprint) for every footprint whose base may lie within radius of
+    // position (XZ plane); callers measure the exact distance themselves
+    template <typename Callback>
+    void for_each_footprint_near(const godot::Vector3 &position, float radius, Callback &&callback) const;
+    
+    // Clearance
+    void update_clearance(const CellRect &area, std::vector<int> *changed_cells);
+    int get_required_clearance(FootprintClass footprint_class) const;
+    const std::vector<uint64_t> &get_class_walkable_bits(FootprintClass footprint_class) const;
+    int get_field_key(int goal_index, FootprintClass footprint_class) const;
+    int get_clearance_at(const godot::Vector3 &world_pos) const;
+    
+    // Obstacle distance field (negative inside blocked cells)
+    void update_obstacle_distance(const CellRect &area);
+    float sample_obstacle_distance(const godot::Vector3 &world_pos, godot::Vector3 *gradient) const;
+    float get_obstacle_distance_at(const godot::Vector3 &world_pos) const;
+    godot::Vector3 get_obstacle_gradient_at(const godot::Vector3 &world_pos) const;
+    float trace_obstacle_distance(const godot::Vector3 &from, const godot::Vector3 &direction, float max_distance, float radius = 0.0f) const;
+    
+    // Congestion
+    bool is_density_update_due() const;
+    void update_density(const godot::PackedVector3Array &unit_positions);
+    uint8_t get_effective_cost(int index) const;
+    bool lift_congestion_costs();
+    void restore_congestion_costs();
+    float get_density_at(const godot::Vector3 &world_pos) const;
+    
+    // Static targets
+    int register_static_target(const godot::Vector3 &target_world_pos, int footprint_class = 0);
+    void unregister_static_target(int field_id);
+    int get_static_target_count() const;
+    int find_static_field(int goal_index, FootprintClass footprint_class) const;
+    void refresh_static_field(FlowField &field);
+    void refresh_static_fields();
+    size_t get_pinned_memory_usage() const;
+    uint64_t compute_walkability_hash(FootprintClass footprint_class) const;
+    godot::String get_static_field_path(const FlowField &field) const;
+    bool save_static_field(const FlowField &field) const;
+    bool load_static_field(FlowField &field) const;
     
     // Flow field computation
     void compute_flow_field(const godot::Vector3 &target_world_pos);
-    void compute_distances(int target_x, int target_y);
-    void compute_directions();
+    void integrate_field(FlowField &field);
+    void build_field(FlowField &field);
+    const std::vector<uint64_t> &get_field_passable(const FlowField &field, std::vector<uint64_t> &scratch, std::vector<CellRect> *regions) const;
+    void open_goal_reach(const FlowField &field, std::vector<uint64_t> &passable) const;
+    
+    // Windowed integration
+    void fit_field_window(FlowField &field) const;
+    bool grow_field_window(FlowField &field) const;
+    bool field_reaches_starts(const FlowField &field) const;
+    bool field_stopped_short_of(const FlowField &field, int cell) const;
+    
+    // Background computation
+    void submit_flow_field_job(FlowField &field);
+    void _run_flow_field_job(int job_id);
+    void poll_flow_field_jobs();
+    void wait_for_flow_field_jobs();
+    void record_field_latency(float latency_ms);
+    int get_pending_job_count() const;
+    float get_last_field_latency_ms() const;
+    float get_average_field_latency_ms() const;
+    
+    // Incremental repair after walkability changes
+    void repair_flow_fields(const std::vector<int> &changed_cells);
+    void repair_field(FlowField &field, const std::vector<int> &changed_cells);
+    
+    // Sector/portal graph
+    void rebuild_portal_graph();
+    void add_border_entrances(int sector_a, int sector_b, bool vertical_border);
+    void ensure_sector_edges(int sector);
+    void mark_sectors_dirty(const CellRect &rect);
+    bool find_corridor_sectors(int goal_index, const std::vector<int> &start_cells, std::vector<uint8_t> &sector_mask);
+    int get_sector_of_cell(int cell_index) const;
+    CellRect get_sector_rect(int sector) const;
+    int get_portal_count() const;
+    
+    // Flow field cache
+    int request_flow_field(const godot::Vector3 &target_world_pos, const godot::PackedVector3Array &start_positions = godot::PackedVector3Array(), int footprint_class = 0);
+    int request_multi_goal_flow_field(const godot::PackedVector3Array &target_world_positions, int footprint_class = 0);
+    bool has_flow_field(int field_id) const;
+    bool field_covers_position(int field_id, const godot::Vector3 &world_pos) const;
+    void release_flow_field(int field_id);
+    void clear_flow_field_cache();
+    void touch_field(FlowField &field);
+    void evict_to_budget();
+    int get_cached_field_count() const;
+    int get_cache_memory_usage() const;
+    int get_grid_memory_usage() const;
     
     // Query
     godot::Vector3 get_flow_direction(const godot::Vector3 &world_pos) const;
+    godot::Vector3 get_flow_direction_for(int field_id, const godot::Vector3 &world_pos) const;
+    godot::PackedVector3Array get_flow_directions(int field_id, const godot::PackedVector3Array &world_positions) const;
+    godot::Vector3 get_line_of_sight_direction(const FlowField &field, const godot::Vector3 &world_pos) const;
+    godot::Vector3 get_flow_lookahead_point(int field_id, const godot::Vector3 &world_pos, float lookahead_distance) const;
+    
+    // Single-unit paths
+    godot::PackedVector3Array find_path(const godot::Vector3 &from, const godot::Vector3 &to, int footprint_class = 0);
+    bool should_use_path(int unit_count) const;
+    int get_walkability_version() const;
+    float get_last_path_time_ms() const;
+    
     bool is_position_walkable(const godot::Vector3 &world_pos) const;
     
     // Coordinate conversion
@@ -98,12 +365,110 @@ public:
     void set_debug_draw(bool enabled);
     bool get_debug_draw() const;
     
+    void set_cache_budget_mb(float budget);
+    float get_cache_budget_mb() const;
+    
+    void set_integration_engine(int engine);
+    int get_integration_engine() const;
+    
+    void set_use_hierarchical_search(bool enabled);
+    bool get_use_hierarchical_search() const;
+    
+    void set_sector_size(int size);
+    int get_sector_size() const;
+    
+    void set_use_threaded_computation(bool enabled);
+    bool get_use_threaded_computation() const;
+    
+    void set_use_line_of_sight(bool enabled);
+    bool get_use_line_of_sight() const;
+    
+    void set_use_windowed_search(bool enabled);
+    bool get_use_windowed_search() const;
+    
+    void set_window_padding(int padding);
+    int get_window_padding() const;
+    
+    void set_use_early_termination(bool enabled);
+    bool get_use_early_termination() const;
+    
+    void set_termination_margin(float margin);
+    float get_termination_margin() const;
+    
+    void set_max_walkable_slope(float slope);
+    float get_max_walkable_slope() const;
+    
+    void set_max_height_difference(float difference);
+    float get_max_height_difference() const;
+    
+    void set_slope_cost_scale(float scale);
+    float get_slope_cost_scale() const;
+    
+    void set_footprint_radius(int footprint_class, float radius);
+    float get_footprint_radius(int footprint_class) const;
+    
+    void set_use_density_costs(bool enabled);
+    bool get_use_density_costs() const;
+    
+    void set_density_update_interval(float interval);
+    float get_density_update_interval() const;
+    
+    void set_density_decay(float decay);
+    float get_density_decay() const;
+    
+    void set_density_cost_scale(float scale);
+    float get_density_cost_scale() const;
+    
+    void set_max_density_cost(int cost);
+    int get_max_density_cost() const;
+    
+    void set_congestion_repair_interval(float interval);
+    float get_congestion_repair_interval() const;
+    
+    void set_path_unit_threshold(int threshold);
+    int get_path_unit_threshold() const;
+    
+    void set_path_heuristic_weight(float weight);
+    float get_path_heuristic_weight() const;
+    
+    void set_path_max_expansions(int expansions);
+    int get_path_max_expansions() const;
+    
+    void set_persist_static_fields(bool enabled);
+    bool get_persist_static_fields() const;
+    
+    void set_static_field_directory(const godot::String &directory);
+    godot::String get_static_field_directory() const;
+    
     bool is_field_valid() const;
     
     // Debug visualization
     void draw_debug_field();
 };
 
+template <typename Callback>
+void FlowFieldManager::for_each_footprint_near(const godot::Vector3 &position, float radius, Callback &&callback) const {
+    if (footprint_buckets.empty()) {
+        return;
+    }
+    
+    // Footprints are bucketed by centre, so widen the search by the largest half-size
+    const float reach = radius + max_footprint_half_size;
+    const int x0 = footprint_bucket_coord(position.x - reach);
+    const int x1 = footprint_bucket_coord(position.x + reach);
+    const int z0 = footprint_bucket_coord(position.z - reach);
+    const int z1 = footprint_bucket_coord(position.z + reach);
+    for (int z = z0; z <= z1; z++) {
+        for (int x = x0; x <= x1; x++) {
+            auto it = footprint_buckets.find(footprint_bucket_key(x, z));
+            if (it == footprint_buckets.end()) continue;
+            for (int index : it->second) {
+                callback(building_footprints[index]);
+            }
+        }
+    }
+}
+
 } // namespace rts
 
 #endif // FLOW_FIELD_MANAGER_H
@@ -71,7 +71,7 @@ public:
 
     // Input handling
     void handle_left_click(const godot::Vector2 &position, bool shift_held);
-    void handle_right_click(const godot::Vector2 &position);
+    void handle_right_click(const godot::Vector2 &position, bool shift_held = false);
     void handle_drag_start(const godot::Vector2 &position);
     void handle_drag_update(const godot::Vector2 &position);
     void handle_drag_end();
@@ -84,8 +84,9 @@ public:
     void update_selection_rect_ui();
     void show_selection_rect(bool visible);
     
-    // Move orders
-    void issue_move_order(const godot::Vector3 &target);
+    // Move orders; queued (shift) orders become waypoints, and selections up to the
+    // flow field manager's path threshold get A* paths instead of a field
+    void issue_move_order(const godot::Vector3 &target, bool queued = false);
 
     // Setters
     void set_camera(godot::Camera3D *cam);
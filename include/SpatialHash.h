@@ -0,0 +1,144 @@
+/**
+ * SpatialHash.h
+ * Uniform grid hash of unit and vehicle positions for neighbour queries.
+ * Rebuilt once per physics tick with a counting sort.
+ */
+
+#ifndef SPATIAL_HASH_H
+#define SPATIAL_HASH_H
+
+#include <godot_cpp/classes/node3d.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/array.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace rts {
+
+// Entity layers, matching the physics collision layers of the same objects
+static constexpr uint32_t SPATIAL_LAYER_UNITS = 2;
+static constexpr uint32_t SPATIAL_LAYER_VEHICLES = 8;
+
+class SpatialHash : public godot::Node {
+    GDCLASS(SpatialHash, godot::Node)
+
+public:
+    // Snapshot of one entity at the last rebuild
+    struct Entry {
+        godot::Vector3 position;
+        int cell_x = 0;
+        int cell_z = 0;
+        uint32_t layer = 0;
+        godot::Node3D *node = nullptr;
+    };
+
+private:
+    // Settings
+    float cell_size = 2.0f;               // About one separation radius
+    
+    // Registered entities; swap-removed, so indices are not stable
+    struct Registration {
+        godot::Node3D *node = nullptr;
+        uint32_t layer = 0;
+    };
+    std::vector<Registration> registered;
+    std::unordered_map<godot::Node3D *, int> registered_index;
+    
+    // Built by rebuild(): entries sorted by bucket, bucket b spans [bucket_start[b], bucket_start[b + 1])
+    std::vector<Entry> entries;
+    std::vector<Entry> unsorted_entries;
+    std::vector<uint32_t> bucket_of;
+    std::vector<int> bucket_start;
+    std::vector<int> bucket_fill;
+    uint32_t bucket_mask = 0;
+    float last_rebuild_ms = 0.0f;
+    
+    static uint32_t hash_cell(int x, int z) {
+        return (static_cast<uint32_t>(x) * 73856093u) ^ (static_cast<uint32_t>(z) * 19349663u);
+    }
+    int cell_coord(float value) const {
+        return static_cast<int>(std::floor(value / cell_size));
+    }
+
+protected:
+    static void _bind_methods();
+
+public:
+    SpatialHash();
+    ~SpatialHash();
+    
+    void _ready() override;
+    void _physics_process(double delta) override;
+    
+    // Registration
+    void register_entity(godot::Node3D *node, int layer);
+    void unregister_entity(godot::Node3D *node);
+    int get_entity_count() const;
+    
+    void rebuild();
+    
+    // Calls callback(entry, distance_squared) for every entity on layer_mask within radius
+    // of position (XZ plane), as of the last rebuild
+    template <typename Callback>
+    void for_each_neighbor(const godot::Vector3 &position, float radius, uint32_t layer_mask, Callback &&callback) const;
+    
+    godot::Array get_neighbors(const godot::Vector3 &position, float radius, int layer_mask) const;
+    godot::Node3D *find_nearest(const godot::Vector3 &position, float radius, int layer_mask, godot::Node3D *exclude = nullptr) const;
+    
+    // Getters/Setters
+    void set_cell_size(float size);
+    float get_cell_size() const;
+    
+    float get_last_rebuild_ms() const;
+};
+
+template <typename Callback>
+void SpatialHash::for_each_neighbor(const godot::Vector3 &position, float radius, uint32_t layer_mask, Callback &&callback) const {
+    if (entries.empty()) {
+        return;
+    }
+    
+    const float radius_sq = radius * radius;
+    auto visit = [&](const Entry &entry) {
+        if (!(entry.layer & layer_mask)) return;
+        float dx = entry.position.x - position.x;
+        float dz = entry.position.z - position.z;
+        float distance_sq = dx * dx + dz * dz;
+        if (distance_sq <= radius_sq) {
+            callback(entry, distance_sq);
+        }
+    };
+    
+    const int x0 = cell_coord(position.x - radius);
+    const int x1 = cell_coord(position.x + radius);
+    const int z0 = cell_coord(position.z - radius);
+    const int z1 = cell_coord(position.z + radius);
+    
+    // A radius spanning more cells than there are buckets is cheaper as a flat scan
+    if (static_cast<int64_t>(x1 - x0 + 1) * (z1 - z0 + 1) > static_cast<int64_t>(bucket_mask) + 1) {
+        for (const Entry &entry : entries) {
+            visit(entry);
+        }
+        return;
+    }
+    
+    // Buckets are shared by colliding cells, so entries are matched on their own cell
+    for (int z = z0; z <= z1; z++) {
+        for (int x = x0; x <= x1; x++) {
+            uint32_t bucket = hash_cell(x, z) & bucket_mask;
+            for (int i = bucket_start[bucket]; i < bucket_start[bucket + 1]; i++) {
+                const Entry &entry = entries[i];
+                if (entry.cell_x == x && entry.cell_z == z) {
+                    visit(entry);
+                }
+            }
+        }
+    }
+}
+
+} // namespace rts
+
+#endif // SPATIAL_HASH_H
@@ -275,6 +275,9 @@ public:
     bool is_buildable_at(float x, float z) const;
     bool is_within_bounds(float x, float z) const;
     
+    // Native heightmap access (row-major z * map_size + x, normalized; scale by max_height)
+    const godot::PackedFloat32Array &get_heightmap() const;
+    
     // Configuration setters/getters
     void set_map_size(int size);
     int get_map_size() const;
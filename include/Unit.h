@@ -1,8 +1,7 @@
 /**
  * Unit.h
- * RTS unit class with movement, selection state, and flow field integration.
- * Supports receiving move orders and smooth steering movement.
- * Includes collision avoidance for buildings, other units, and vehicles.
+ * RTS unit class with orders, selection state, and flow field integration.
+ * Movement is stepped by CrowdSystem; the unit holds its orders and a crowd slot.
  */
 
 #ifndef UNIT_H
@@ -10,64 +9,45 @@
 
 #include <godot_cpp/classes/node3d.hpp>
 #include <godot_cpp/classes/character_body3d.hpp>
-#include <godot_cpp/classes/sphere_shape3d.hpp>
-#include <godot_cpp/classes/physics_shape_query_parameters3d.hpp>
-#include <godot_cpp/classes/physics_ray_query_parameters3d.hpp>
 #include <godot_cpp/core/class_db.hpp>
 
+#include <deque>
+
 namespace rts {
 
+class SpatialHash;
+class CrowdSystem;
+
 class Unit : public godot::CharacterBody3D {
     GDCLASS(Unit, godot::CharacterBody3D)
 
 private:
-    // Movement settings
+    // Movement settings; the per-tick state lives in the unit's CrowdSystem slot
     float move_speed = 8.0f;
-    float base_move_speed = 8.0f;         // Store original speed for slope calculations
-    float acceleration = 15.0f;
-    float deceleration = 20.0f;
-    float steering_strength = 5.0f;
-    float arrival_threshold = 0.5f;
-    
-    // Terrain following
-    float uphill_speed_multiplier = 0.5f;   // Speed multiplier when going uphill
-    float downhill_speed_multiplier = 1.4f; // Speed multiplier when going downhill
-    float current_slope = 0.0f;             // Current terrain slope (-1 to 1, negative = downhill)
-    float terrain_height = 0.0f;            // Current terrain height
-    float last_terrain_height = 0.0f;       // Previous frame terrain height
-    float max_traversable_slope = 0.85f;    // Max slope unit can climb (0-1, ~60 degrees)
-    
-    // Collision avoidance settings
-    float avoidance_radius = 5.0f;        // How far ahead to look for obstacles
-    float avoidance_strength = 15.0f;     // How strongly to avoid obstacles
-    float separation_radius = 1.2f;       // Minimum distance from other units
-    float separation_strength = 10.0f;    // How strongly to separate from other units
-    float wall_follow_distance = 2.0f;    // Distance to maintain when following walls
-    uint32_t obstacle_mask = 0b0100;      // Layer 4: Buildings only (for steering avoidance)
-    
-    // Pathfinding state
-    bool is_avoiding = false;             // Currently avoiding an obstacle
-    float avoid_direction = 0.0f;         // -1 = left, 1 = right
-    float stuck_timer = 0.0f;             // Time spent possibly stuck
-    godot::Vector3 last_position;         // For stuck detection
-    
-    // Walking animation
-    float walk_bob_amount = 0.08f;  // Vertical bobbing
-    float walk_bob_speed = 12.0f;   // Bob frequency
-    float walk_sway_amount = 0.02f; // Side-to-side sway
-    float walk_time = 0.0f;         // Animation timer
-    float base_y_offset = 0.0f;     // Original Y offset
+    CrowdSystem *crowd = nullptr;
+    int crowd_index = -1;                 // Slot in the crowd arrays (-1 = not joined)
     
     // State
     bool is_selected = false;
     bool is_hovered = false;
-    bool has_move_order = false;
-    godot::Vector3 target_position;
-    godot::Vector3 current_velocity;
     
-    // Flow field movement
-    godot::Vector3 flow_vector;
-    bool use_flow_field = true;
+    // Flow field assigned by UnitSpawner
+    int flow_field_id = -1;               // Handle into the FlowFieldManager cache (-1 = none)
+    
+    // Queued orders after the current target, each with the field for its leg
+    struct Waypoint {
+        godot::Vector3 position;
+        int field_id = -1;                // Built ahead of time by UnitSpawner (-1 = not yet)
+    };
+    std::deque<Waypoint> waypoints;
+    bool patrol = false;                  // Reached targets are re-queued at the back
+    
+    // A* path for small selections; replaces the flow field while active
+    bool use_path = false;
+    godot::PackedVector3Array path_points;
+    int path_index = 0;
+    int path_version = -1;                // Walkability version the path was planned on (-1 = needs planning)
+    float path_point_radius = 1.0f;       // Distance at which the next path point takes over
     
     // Visual feedback
     int unit_id = -1;
@@ -80,12 +60,7 @@ private:
     float attack_range = 5.0f;
     
     // Cached references for performance
-    godot::Node *cached_terrain_generator = nullptr;
-    
-    // Cached physics shapes (avoid per-frame allocations)
-    godot::Ref<godot::SphereShape3D> cached_separation_sphere;
-    godot::Ref<godot::PhysicsShapeQueryParameters3D> cached_shape_query;
-    godot::Ref<godot::PhysicsRayQueryParameters3D> cached_ray_query;
+    SpatialHash *cached_spatial_hash = nullptr;
 
 protected:
     static void _bind_methods();
@@ -94,30 +69,46 @@ public:
     Unit();
     ~Unit();
 
+    void _enter_tree() override;
     void _ready() override;
-    void _physics_process(double delta) override;
+    void _exit_tree() override;
 
     // Movement
     void set_move_target(const godot::Vector3 &target);
     void apply_flow_vector(const godot::Vector3 &vector);
     void stop_movement();
     
-    void update_movement(double delta);
-    void update_walk_animation(double delta);
-    godot::Vector3 calculate_steering(const godot::Vector3 &desired_velocity) const;
-    
-    // Collision avoidance
-    godot::Vector3 calculate_avoidance_force();
-    godot::Vector3 calculate_separation_force();
-    godot::Vector3 find_clear_direction(const godot::Vector3 &preferred_dir);
-    bool check_path_blocked(const godot::Vector3 &direction, float distance);
-    float raycast_distance(const godot::Vector3 &direction, float max_distance);
-    void update_stuck_detection(double delta);
-    void snap_to_terrain();
-    
-    // Terrain slope handling
-    float get_slope_ahead(const godot::Vector3 &direction, float check_distance);
-    bool can_traverse_slope(const godot::Vector3 &direction);
+    void set_flow_field_id(int field_id);
+    int get_flow_field_id() const;
+    
+    // Waypoint queue
+    void queue_move_target(const godot::Vector3 &target, int field_id = -1);
+    void clear_waypoints();
+    bool advance_waypoint();
+    int get_waypoint_count() const;
+    godot::Vector3 get_waypoint(int index) const;
+    godot::PackedVector3Array get_waypoints() const;
+    int get_waypoint_field_id(int index) const;
+    void set_waypoint_field_id(int index, int field_id);
+    godot::Vector3 get_final_target() const;
+    
+    void set_patrol(bool enabled);
+    bool get_patrol() const;
+    
+    // Single-unit path
+    void set_path(const godot::PackedVector3Array &points, int version);
+    void clear_path();
+    bool is_following_path() const;
+    int get_path_version() const;
+    godot::PackedVector3Array get_path_points() const;
+    
+    // Called by CrowdSystem
+    bool steer_along_path(const godot::Vector3 &position, godot::Vector3 &direction);
+    int get_path_index() const;
+    void set_path_index(int index);
+    void on_target_reached();
+    void set_crowd_index(int index);
+    int get_crowd_index() const;
 
     // Selection
     void set_selected(bool selected);
@@ -153,12 +144,14 @@ public:
     float get_attack_range() const;
     
     bool is_moving() const;
+    bool get_has_move_order() const;
     godot::Vector3 get_target_position() const;
 
     // Signals
     // signal unit_selected(unit: Unit)
     // signal unit_deselected(unit: Unit)
     // signal unit_arrived(unit: Unit)
+    // signal waypoint_reached(unit: Unit, waypoint: Vector3)
 };
 
 } // namespace rts
@@ -82,6 +82,8 @@ public:
     
     // Flow field integration
     void update_units_flow_vectors();
+    void update_unit_density();
+    void prefetch_waypoint_fields(Unit *unit);
 
     // Setters
     void set_selection_manager(SelectionManager *manager);
@@ -18,6 +18,9 @@
 
 namespace rts {
 
+class FlowFieldManager;
+class SpatialHash;
+
 class Vehicle : public godot::CharacterBody3D {
     GDCLASS(Vehicle, godot::CharacterBody3D)
 
@@ -61,6 +64,12 @@ protected:
     godot::Vector3 target_position;
     godot::Vector3 current_velocity;
     
+    // Flow field movement
+    int footprint_class = 1;              // FootprintClass used for clearance (1 = light vehicle)
+    int flow_field_id = -1;               // Handle into the FlowFieldManager cache (-1 = none)
+    float flow_lookahead_scale = 1.5f;    // Lookahead along the field, in turning radii (move_speed / turn_speed)
+    float stuck_raycast_delay = 0.5f;     // Seconds wedged on a field before falling back to obstacle avoidance
+    
     // Visual
     int vehicle_id = -1;
     godot::MeshInstance3D *mesh_instance = nullptr;
@@ -73,6 +82,8 @@ protected:
     
     // Cached references for performance
     godot::Node *cached_terrain_generator = nullptr;
+    FlowFieldManager *cached_flow_field_manager = nullptr;
+    SpatialHash *cached_spatial_hash = nullptr;
     
     // Cached physics shapes (avoid per-frame allocations)
     godot::Ref<godot::SphereShape3D> cached_separation_sphere;
@@ -85,7 +96,9 @@ public:
     Vehicle();
     ~Vehicle();
 
+    void _enter_tree() override;
     void _ready() override;
+    void _exit_tree() override;
     void _process(double delta) override;
     void _physics_process(double delta) override;
     
@@ -99,12 +112,13 @@ public:
     void move_to(const godot::Vector3 &position);
     void stop_moving();
     bool get_is_moving() const;
+    godot::Vector3 get_current_velocity() const;   // Steering velocity of the last physics tick
     
     // Collision avoidance
     godot::Vector3 calculate_avoidance_force();
     godot::Vector3 calculate_separation_force();
     godot::Vector3 find_clear_direction(const godot::Vector3 &preferred_dir);
-    float raycast_distance(const godot::Vector3 &direction, float max_distance);
+    float obstacle_clearance(const godot::Vector3 &direction, float max_distance);   // Distance field, or a physics ray without a nav grid
     bool check_path_blocked(const godot::Vector3 &direction, float distance);
     void update_stuck_detection(double delta);
     void snap_to_terrain();
@@ -146,6 +160,12 @@ public:
     
     void set_model_scale(float scale);
     float get_model_scale() const;
+    
+    void set_footprint_class(int size_class);
+    int get_footprint_class() const;
+    
+    void set_flow_lookahead_scale(float scale);
+    float get_flow_lookahead_scale() const;
 };
 
 } // namespace rts
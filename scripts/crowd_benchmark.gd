@@ -0,0 +1,34 @@
+extends Node3D
+
+# Spawns crowds of increasing size and prints how the crowd steering phase
+# scales with worker count, then quits. Run with: godot --path . scenes/CrowdBenchmark.tscn
+
+const AGENT_COUNTS := [1000, 5000, 10000]
+const ITERATIONS := 30
+
+@onready var spawner := $UnitSpawner
+@onready var crowd := $CrowdSystem
+
+func _ready() -> void:
+	for count in AGENT_COUNTS:
+		spawner.despawn_all_units()
+		await get_tree().process_frame
+		
+		spawner.spawn_units_in_formation(count, Vector3.ZERO, sqrt(count) * 1.5)
+		for child in spawner.get_children():
+			if child is Unit:
+				child.set_move_target(-child.global_position)
+		
+		# Let the spatial hash and crowd pick up the new units before timing
+		await get_tree().physics_frame
+		await get_tree().physics_frame
+		print_results(crowd.benchmark_steering(ITERATIONS))
+	
+	get_tree().quit()
+
+func print_results(results: Dictionary) -> void:
+	print("Crowd steering, %d agents: serial %.3f ms" % [results["agents"], results["serial_ms"]])
+	for workers in results:
+		if workers is int:
+			var entry: Dictionary = results[workers]
+			print("  %2d workers: %.3f ms (%.2fx)" % [workers, entry["ms"], entry["speedup"]])
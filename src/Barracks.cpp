@@ -6,6 +6,7 @@
 
 #include "Barracks.h"
 #include "Unit.h"
+#include "FlowFieldManager.h"
 
 #include <godot_cpp/classes/engine.hpp>
 #include <godot_cpp/classes/scene_tree.hpp>
@@ -926,6 +927,22 @@ Vector3 Barracks::get_rally_point() const {
 
 void Barracks::set_rally_point(const Vector3 &point) {
     rally_point = point;
+    
+    // Move the pinned field along with the rally point; pinning the new one first keeps the
+    // field, with no rebuild, when the point stays on the same cell
+    if (flow_field_manager) {
+        int previous_field_id = rally_field_id;
+        rally_field_id = pin_static_target(rally_point, (int)FootprintClass::INFANTRY);
+        unpin_static_target(previous_field_id);
+    }
+}
+
+void Barracks::register_flow_field_targets() {
+    // Placement moves the barracks after _ready, so derive the points from the final position
+    spawn_point = get_global_position() + Vector3(0, 0, BUILDING_DEPTH / 2.0f + 3.0f);
+    rally_point = spawn_point + Vector3(0, 0, 5.0f);
+    
+    rally_field_id = pin_static_target(rally_point, (int)FootprintClass::INFANTRY);
 }
 
 int Barracks::get_unit_queue() const {
@@ -20,6 +20,8 @@
 #include <godot_cpp/classes/physics_shape_query_parameters3d.hpp>
 #include <godot_cpp/variant/utility_functions.hpp>
 
+#include <algorithm>
+
 using namespace godot;
 
 namespace rts {
@@ -123,6 +125,11 @@ void Building::snap_to_terrain() {
     }
 }
 
+void Building::_exit_tree() {
+    // Pinned fields sit outside the cache budget, so a removed building must let go of them
+    unpin_static_targets();
+}
+
 void Building::_process(double delta) {
     if (Engine::get_singleton()->is_editor_hint()) {
         return;
@@ -650,7 +657,45 @@ void Building::notify_flow_field_of_placement() {
         // Mark this building's area as unwalkable
         flow_field->call("mark_building_area", get_global_position(), building_size, false);
         UtilityFunctions::print("Building: Notified FlowFieldManager of placement");
+        
+        // Walkability around the footprint is final now, so static targets can be precomputed
+        unpin_static_targets();
+        flow_field_manager = Object::cast_to<FlowFieldManager>(flow_field);
+        if (flow_field_manager) {
+            register_flow_field_targets();
+        }
+    }
+}
+
+void Building::register_flow_field_targets() {
+    // Buildings without fixed unit destinations have nothing to register
+}
+
+int Building::pin_static_target(const Vector3 &position, int footprint_class) {
+    if (!flow_field_manager) return -1;
+    
+    int field_id = flow_field_manager->register_static_target(position, footprint_class);
+    if (field_id >= 0) {
+        static_target_ids.push_back(field_id);
+    }
+    return field_id;
+}
+
+void Building::unpin_static_target(int field_id) {
+    auto it = std::find(static_target_ids.begin(), static_target_ids.end(), field_id);
+    if (it == static_target_ids.end()) return;
+    
+    static_target_ids.erase(it);
+    flow_field_manager->unregister_static_target(field_id);
+}
+
+void Building::unpin_static_targets() {
+    if (flow_field_manager) {
+        for (int field_id : static_target_ids) {
+            flow_field_manager->unregister_static_target(field_id);
+        }
     }
+    static_target_ids.clear();
 }
 
 } // namespace rts
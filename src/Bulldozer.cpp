@@ -6,6 +6,7 @@
 #include "Bulldozer.h"
 #include "FloorSnapper.h"
 #include "Barracks.h"
+#include "FlowFieldManager.h"
 
 #include <godot_cpp/classes/engine.hpp>
 #include <godot_cpp/classes/box_mesh.hpp>
@@ -66,6 +67,7 @@ void Bulldozer::_bind_methods() {
 Bulldozer::Bulldozer() {
     vehicle_name = "Bulldozer";
     move_speed = 3.0f;  // Slower than regular units
+    footprint_class = (int)FootprintClass::HEAVY_VEHICLE;
     health = 300;
     max_health = 300;
 }
@@ -5,6 +5,7 @@
 
 #include "CommandCenter.h"
 #include "Bulldozer.h"
+#include "FlowFieldManager.h"
 
 #include <godot_cpp/classes/engine.hpp>
 #include <godot_cpp/classes/box_mesh.hpp>
@@ -78,6 +79,9 @@ void CommandCenter::_ready() {
     // Snap to terrain
     snap_to_terrain();
     
+    // Block the base's cells in the flow field grid
+    notify_flow_field_of_placement();
+    
     // Calculate spawn point (in front of garage)
     spawn_point = get_global_position() + Vector3(0, 0, BASE_DEPTH / 2.0f + 3.0f);
     
@@ -940,6 +944,13 @@ Vector3 CommandCenter::get_rally_point() const {
     return pos;
 }
 
+void CommandCenter::register_flow_field_targets() {
+    // Bulldozers return to the garage, infantry falls back to the spawn and rally points
+    pin_static_target(get_spawn_point(), (int)FootprintClass::HEAVY_VEHICLE);
+    pin_static_target(get_spawn_point(), (int)FootprintClass::INFANTRY);
+    pin_static_target(get_rally_point(), (int)FootprintClass::INFANTRY);
+}
+
 int CommandCenter::get_bulldozer_queue() const {
     return bulldozer_queue;
 }
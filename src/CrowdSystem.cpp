@@ -0,0 +1,983 @@
+/**
+ * CrowdSystem.cpp
+ * Batched movement for every Unit in the scene.
+ */
+
+#include "CrowdSystem.h"
+#include "Unit.h"
+#include "Vehicle.h"
+#include "SpatialHash.h"
+#include "FlowFieldManager.h"
+#include "TerrainGenerator.h"
+
+#include <godot_cpp/classes/engine.hpp>
+#include <godot_cpp/classes/scene_tree.hpp>
+#include <godot_cpp/classes/window.hpp>
+#include <godot_cpp/classes/time.hpp>
+#include <godot_cpp/classes/worker_thread_pool.hpp>
+#include <godot_cpp/classes/os.hpp>
+
+#include <algorithm>
+
+using namespace godot;
+
+namespace rts {
+
+// After the spatial hash rebuild, before vehicles
+static const int CROWD_SYSTEM_PHYSICS_PRIORITY = -50;
+
+// Agents per steering task; large enough that a chunk outweighs the task dispatch
+static const int CROWD_STEERING_CHUNK = 256;
+
+// ORCA: collision radii on the XZ plane, and how many constraints one agent considers
+static const float CROWD_AGENT_RADIUS = 0.4f;        // Unit capsule radius
+static const float CROWD_VEHICLE_RADIUS = 1.25f;     // Half-diagonal of a vehicle's footprint
+static const int ORCA_MAX_NEIGHBORS = 10;
+static const int ORCA_MAX_OBSTACLES = 6;
+static const int ORCA_MAX_LINES = ORCA_MAX_NEIGHBORS + ORCA_MAX_OBSTACLES;
+static const float ORCA_EPSILON = 0.00001f;
+
+// Half-plane of permitted velocities: everything left of direction through point
+struct OrcaLine {
+    Vector2 point;
+    Vector2 direction;
+};
+
+// Optimizes along one line, subject to the lines before it and the speed circle
+static bool orca_linear_program1(const OrcaLine *lines, int line_no, float radius, const Vector2 &opt_velocity, bool direction_opt, Vector2 &result) {
+    const OrcaLine &line = lines[line_no];
+    const float dot_product = line.point.dot(line.direction);
+    const float discriminant = dot_product * dot_product + radius * radius - line.point.length_squared();
+    if (discriminant < 0.0f) {
+        // The speed circle lies entirely outside this half-plane
+        return false;
+    }
+    
+    const float sqrt_discriminant = Math::sqrt(discriminant);
+    float t_left = -dot_product - sqrt_discriminant;
+    float t_right = -dot_product + sqrt_discriminant;
+    
+    for (int i = 0; i < line_no; i++) {
+        const float denominator = line.direction.cross(lines[i].direction);
+        const float numerator = lines[i].direction.cross(line.point - lines[i].point);
+        
+        if (Math::abs(denominator) <= ORCA_EPSILON) {
+            // Parallel lines; either this one is fully excluded or the other adds nothing
+            if (numerator < 0.0f) {
+                return false;
+            }
+            continue;
+        }
+        
+        const float t = numerator / denominator;
+        if (denominator >= 0.0f) {
+            t_right = Math::min(t_right, t);
+        } else {
+            t_left = Math::max(t_left, t);
+        }
+        if (t_left > t_right) {
+            return false;
+        }
+    }
+    
+    float t;
+    if (direction_opt) {
+        t = opt_velocity.dot(line.direction) > 0.0f ? t_right : t_left;
+    } else {
+        t = Math::clamp(line.direction.dot(opt_velocity - line.point), t_left, t_right);
+    }
+    result = line.point + line.direction * t;
+    return true;
+}
+
+// Closest velocity to opt_velocity inside every half-plane and the speed circle; returns the
+// index of the first line that could not be satisfied, or count on success
+static int orca_linear_program2(const OrcaLine *lines, int count, float radius, const Vector2 &opt_velocity, bool direction_opt, Vector2 &result) {
+    if (direction_opt) {
+        result = opt_velocity * radius;
+    } else if (opt_velocity.length_squared() > radius * radius) {
+        result = opt_velocity.normalized() * radius;
+    } else {
+        result = opt_velocity;
+    }
+    
+    for (int i = 0; i < count; i++) {
+        if (lines[i].direction.cross(lines[i].point - result) > 0.0f) {
+            const Vector2 previous = result;
+            if (!orca_linear_program1(lines, i, radius, opt_velocity, direction_opt, result)) {
+                result = previous;
+                return i;
+            }
+        }
+    }
+    return count;
+}
+
+// Infeasible crowding: keeps obstacle lines hard and minimizes the worst violation of the rest
+static void orca_linear_program3(const OrcaLine *lines, int count, int obstacle_count, int begin_line, float radius, Vector2 &result) {
+    OrcaLine projected[ORCA_MAX_LINES];
+    float distance = 0.0f;
+    
+    for (int i = begin_line; i < count; i++) {
+        if (lines[i].direction.cross(lines[i].point - result) <= distance) {
+            continue;
+        }
+        
+        int projected_count = 0;
+        for (int k = 0; k < obstacle_count; k++) {
+            projected[projected_count++] = lines[k];
+        }
+        for (int j = obstacle_count; j < i; j++) {
+            OrcaLine line;
+            const float determinant = lines[i].direction.cross(lines[j].direction);
+            if (Math::abs(determinant) <= ORCA_EPSILON) {
+                if (lines[i].direction.dot(lines[j].direction) > 0.0f) {
+                    continue;
+                }
+                line.point = (lines[i].point + lines[j].point) * 0.5f;
+            } else {
+                line.point = lines[i].point + lines[i].direction * (lines[j].direction.cross(lines[i].point - lines[j].point) / determinant);
+            }
+            line.direction = (lines[j].direction - lines[i].direction).normalized();
+            projected[projected_count++] = line;
+        }
+        
+        const Vector2 previous = result;
+        const Vector2 away = Vector2(-lines[i].direction.y, lines[i].direction.x);
+        if (orca_linear_program2(projected, projected_count, radius, away, true, result) < projected_count) {
+            // Only numerical error gets here; the previous result is the best known
+            result = previous;
+        }
+        distance = lines[i].direction.cross(lines[i].point - result);
+    }
+}
+
+void CrowdSystem::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("get_agent_count"), &CrowdSystem::get_agent_count);
+    ClassDB::bind_method(D_METHOD("update_agents", "delta"), &CrowdSystem::update_agents);
+    ClassDB::bind_method(D_METHOD("get_last_update_ms"), &CrowdSystem::get_last_update_ms);
+    ClassDB::bind_method(D_METHOD("_steer_chunk", "chunk"), &CrowdSystem::_steer_chunk);
+    ClassDB::bind_method(D_METHOD("benchmark_steering", "iterations"), &CrowdSystem::benchmark_steering, DEFVAL(30));
+    
+    ClassDB::bind_method(D_METHOD("set_avoidance_mode", "mode"), &CrowdSystem::set_avoidance_mode);
+    ClassDB::bind_method(D_METHOD("get_avoidance_mode"), &CrowdSystem::get_avoidance_mode);
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "avoidance_mode", PROPERTY_HINT_ENUM, "Steering,ORCA"), "set_avoidance_mode", "get_avoidance_mode");
+    
+    ClassDB::bind_method(D_METHOD("set_orca_time_horizon", "seconds"), &CrowdSystem::set_orca_time_horizon);
+    ClassDB::bind_method(D_METHOD("get_orca_time_horizon"), &CrowdSystem::get_orca_time_horizon);
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "orca_time_horizon", PROPERTY_HINT_RANGE, "0.25,10.0,0.25"), "set_orca_time_horizon", "get_orca_time_horizon");
+    
+    ClassDB::bind_method(D_METHOD("set_orca_neighbor_distance", "distance"), &CrowdSystem::set_orca_neighbor_distance);
+    ClassDB::bind_method(D_METHOD("get_orca_neighbor_distance"), &CrowdSystem::get_orca_neighbor_distance);
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "orca_neighbor_distance", PROPERTY_HINT_RANGE, "1.0,20.0,0.5"), "set_orca_neighbor_distance", "get_orca_neighbor_distance");
+    
+    ClassDB::bind_method(D_METHOD("set_use_threaded_steering", "enabled"), &CrowdSystem::set_use_threaded_steering);
+    ClassDB::bind_method(D_METHOD("get_use_threaded_steering"), &CrowdSystem::get_use_threaded_steering);
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "use_threaded_steering"), "set_use_threaded_steering", "get_use_threaded_steering");
+    
+    ClassDB::bind_method(D_METHOD("set_acceleration", "value"), &CrowdSystem::set_acceleration);
+    ClassDB::bind_method(D_METHOD("get_acceleration"), &CrowdSystem::get_acceleration);
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "acceleration", PROPERTY_HINT_RANGE, "1.0,100.0,0.5"), "set_acceleration", "get_acceleration");
+    
+    ClassDB::bind_method(D_METHOD("set_deceleration", "value"), &CrowdSystem::set_deceleration);
+    ClassDB::bind_method(D_METHOD("get_deceleration"), &CrowdSystem::get_deceleration);
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "deceleration", PROPERTY_HINT_RANGE, "1.0,100.0,0.5"), "set_deceleration", "get_deceleration");
+    
+    ClassDB::bind_method(D_METHOD("set_turn_rate", "value"), &CrowdSystem::set_turn_rate);
+    ClassDB::bind_method(D_METHOD("get_turn_rate"), &CrowdSystem::get_turn_rate);
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "turn_rate", PROPERTY_HINT_RANGE, "0.5,30.0,0.5"), "set_turn_rate", "get_turn_rate");
+    
+    ClassDB::bind_method(D_METHOD("set_arrival_threshold", "value"), &CrowdSystem::set_arrival_threshold);
+    ClassDB::bind_method(D_METHOD("get_arrival_threshold"), &CrowdSystem::get_arrival_threshold);
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "arrival_threshold", PROPERTY_HINT_RANGE, "0.1,5.0,0.1"), "set_arrival_threshold", "get_arrival_threshold");
+    
+    ClassDB::bind_method(D_METHOD("set_avoidance_radius", "value"), &CrowdSystem::set_avoidance_radius);
+    ClassDB::bind_method(D_METHOD("get_avoidance_radius"), &CrowdSystem::get_avoidance_radius);
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "avoidance_radius", PROPERTY_HINT_RANGE, "1.0,20.0,0.5"), "set_avoidance_radius", "get_avoidance_radius");
+    
+    ClassDB::bind_method(D_METHOD("set_separation_radius", "value"), &CrowdSystem::set_separation_radius);
+    ClassDB::bind_method(D_METHOD("get_separation_radius"), &CrowdSystem::get_separation_radius);
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "separation_radius", PROPERTY_HINT_RANGE, "0.2,5.0,0.1"), "set_separation_radius", "get_separation_radius");
+    
+    ClassDB::bind_method(D_METHOD("set_separation_strength", "value"), &CrowdSystem::set_separation_strength);
+    ClassDB::bind_method(D_METHOD("get_separation_strength"), &CrowdSystem::get_separation_strength);
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "separation_strength", PROPERTY_HINT_RANGE, "0.0,50.0,0.5"), "set_separation_strength", "get_separation_strength");
+}
+
+CrowdSystem::CrowdSystem() {
+}
+
+CrowdSystem::~CrowdSystem() {
+}
+
+void CrowdSystem::_ready() {
+    if (Engine::get_singleton()->is_editor_hint()) {
+        return;
+    }
+    
+    SceneTree *tree = get_tree();
+    if (tree && tree->get_root()) {
+        Node *root = tree->get_root();
+        spatial_hash = Object::cast_to<SpatialHash>(root->find_child("SpatialHash", true, false));
+        flow_field_manager = Object::cast_to<FlowFieldManager>(root->find_child("FlowFieldManager", true, false));
+        terrain = Object::cast_to<TerrainGenerator>(root->find_child("TerrainGenerator", true, false));
+    }
+    
+    set_physics_process_priority(CROWD_SYSTEM_PHYSICS_PRIORITY);
+    set_physics_process(true);
+}
+
+void CrowdSystem::_physics_process(double delta) {
+    if (Engine::get_singleton()->is_editor_hint()) {
+        return;
+    }
+    
+    update_agents(delta);
+}
+
+int CrowdSystem::add_agent(Unit *unit) {
+    int index = static_cast<int>(units.size());
+    
+    MeshInstance3D *mesh = nullptr;
+    for (int i = 0; i < unit->get_child_count() && !mesh; i++) {
+        mesh = Object::cast_to<MeshInstance3D>(unit->get_child(i));
+    }
+    
+    units.push_back(unit);
+    meshes.push_back(mesh);
+    positions.push_back(unit->get_global_position());
+    velocities.push_back(Vector3(0, 0, 0));
+    targets.push_back(unit->get_global_position());
+    flow_vectors.push_back(Vector3(0, 0, 0));
+    base_speeds.push_back(unit->get_move_speed());
+    speeds.push_back(unit->get_move_speed());
+    headings.push_back(unit->get_rotation().y);
+    walk_times.push_back(0.0f);
+    flags.push_back(AGENT_SYNC_POSITION);
+    desired_directions.push_back(Vector3(0, 0, 0));
+    avoidance_velocities.push_back(Vector3(0, 0, 0));
+    
+    return index;
+}
+
+void CrowdSystem::remove_agent(int index) {
+    if (index < 0 || index >= static_cast<int>(units.size())) {
+        return;
+    }
+    
+    int last = static_cast<int>(units.size()) - 1;
+    if (index != last) {
+        units[index] = units[last];
+        meshes[index] = meshes[last];
+        positions[index] = positions[last];
+        velocities[index] = velocities[last];
+        targets[index] = targets[last];
+        flow_vectors[index] = flow_vectors[last];
+        base_speeds[index] = base_speeds[last];
+        speeds[index] = speeds[last];
+        headings[index] = headings[last];
+        walk_times[index] = walk_times[last];
+        flags[index] = flags[last];
+        desired_directions[index] = desired_directions[last];
+        avoidance_velocities[index] = avoidance_velocities[last];
+        units[index]->set_crowd_index(index);
+    }
+    
+    units.pop_back();
+    meshes.pop_back();
+    positions.pop_back();
+    velocities.pop_back();
+    targets.pop_back();
+    flow_vectors.pop_back();
+    base_speeds.pop_back();
+    speeds.pop_back();
+    headings.pop_back();
+    walk_times.pop_back();
+    flags.pop_back();
+    desired_directions.pop_back();
+    avoidance_velocities.pop_back();
+}
+
+int CrowdSystem::get_agent_count() const {
+    return static_cast<int>(units.size());
+}
+
+void CrowdSystem::set_agent_has_order(int index, bool has_order) {
+    if (has_order) {
+        flags[index] |= AGENT_HAS_ORDER;
+    } else {
+        flags[index] &= ~(AGENT_HAS_ORDER | AGENT_AVOIDING | AGENT_ARRIVED);
+    }
+}
+
+void CrowdSystem::set_agent_base_speed(int index, float speed) {
+    base_speeds[index] = speed;
+    speeds[index] = speed;
+}
+
+void CrowdSystem::update_agents(double delta) {
+    uint64_t start_usec = Time::get_singleton()->get_ticks_usec();
+    const int count = static_cast<int>(units.size());
+    const float step = static_cast<float>(delta);
+    
+    // Units placed by their spawner since the last pass start from where they were put
+    for (int i = 0; i < count; i++) {
+        if (flags[i] & AGENT_SYNC_POSITION) {
+            positions[i] = units[i]->get_global_position();
+            headings[i] = units[i]->get_rotation().y;
+            flags[i] &= ~AGENT_SYNC_POSITION;
+        }
+    }
+    
+    // Steering reads only last tick's positions, the spatial hash and the obstacle field, so chunks
+    // run concurrently; movement is then applied in slot order, which keeps results independent of scheduling
+    steering_delta = step;
+    run_steering_phase(-1);
+    for (int i = 0; i < count; i++) {
+        apply_agent(i, step);
+    }
+    
+    // Write back once per moved unit
+    for (int i = 0; i < count; i++) {
+        if (flags[i] & AGENT_MOVED) {
+            units[i]->set_global_transform(Transform3D(Basis(Vector3(0, 1, 0), headings[i]), positions[i]));
+            flags[i] &= ~AGENT_MOVED;
+        }
+        animate_agent(i, step);
+    }
+    
+    // Arrival callbacks may re-order or stop units, so they run once the arrays are settled
+    for (Unit *unit : arrivals) {
+        unit->on_target_reached();
+    }
+    arrivals.clear();
+    
+    last_update_ms = (Time::get_singleton()->get_ticks_usec() - start_usec) / 1000.0f;
+}
+
+void CrowdSystem::run_steering_phase(int max_workers) {
+    const int count = static_cast<int>(units.size());
+    desired_directions.resize(count);
+    avoidance_velocities.resize(count);
+    
+    const int chunk_count = (count + CROWD_STEERING_CHUNK - 1) / CROWD_STEERING_CHUNK;
+    WorkerThreadPool *pool = WorkerThreadPool::get_singleton();
+    if (use_threaded_steering && pool && chunk_count > 1) {
+        int64_t group_id = pool->add_group_task(Callable(this, "_steer_chunk"), chunk_count, max_workers, true, "Crowd steering");
+        pool->wait_for_group_task_completion(group_id);
+        return;
+    }
+    
+    for (int chunk = 0; chunk < chunk_count; chunk++) {
+        _steer_chunk(chunk);
+    }
+}
+
+void CrowdSystem::_steer_chunk(int chunk) {
+    const int begin = chunk * CROWD_STEERING_CHUNK;
+    const int end = std::min(begin + CROWD_STEERING_CHUNK, static_cast<int>(units.size()));
+    for (int i = begin; i < end; i++) {
+        steer_agent(i);
+    }
+}
+
+void CrowdSystem::steer_agent(int index) {
+    // Writes only this agent's outputs and flags; runs on worker threads
+    if (!(flags[index] & AGENT_HAS_ORDER)) {
+        return;
+    }
+    
+    const Vector3 position = positions[index];
+    Vector3 to_target = targets[index] - position;
+    to_target.y = 0;
+    
+    float distance = to_target.length();
+    if (distance < arrival_threshold) {
+        flags[index] |= AGENT_ARRIVED;
+        return;
+    }
+    
+    // Path point, then flow field, then straight at the target
+    Vector3 desired_direction = to_target / distance;
+    Vector3 path_direction;
+    if (units[index]->steer_along_path(position, path_direction)) {
+        desired_direction = path_direction;
+    } else if (flow_vectors[index].length_squared() > 0.01f) {
+        desired_direction = flow_vectors[index].normalized();
+    }
+    
+    if (avoidance_mode == AVOIDANCE_ORCA) {
+        desired_directions[index] = desired_direction;
+        avoidance_velocities[index] = solve_orca_velocity(index, desired_direction * speeds[index]);
+    } else {
+        desired_directions[index] = steer_around_obstacles(index, desired_direction);
+    }
+}
+
+Vector3 CrowdSystem::steer_around_obstacles(int index, const Vector3 &desired_direction) {
+    // Clearance comes from the obstacle distance field, so this runs on worker threads too
+    const Vector3 position = positions[index];
+    
+    // Go around obstacles ahead, and keep going around until the target is in clear view
+    Vector3 move_direction = desired_direction;
+    float forward_distance = obstacle_clearance(position, desired_direction);
+    if (forward_distance < avoidance_radius * 0.8f) {
+        move_direction = find_clear_direction(index, desired_direction);
+        flags[index] |= AGENT_AVOIDING;
+    } else if (flags[index] & AGENT_AVOIDING) {
+        Vector3 to_target = targets[index] - position;
+        to_target.y = 0;
+        float direct_distance = obstacle_clearance(position, to_target.normalized());
+        if (direct_distance >= avoidance_radius * 0.9f) {
+            flags[index] &= ~AGENT_AVOIDING;
+        } else {
+            move_direction = find_clear_direction(index, desired_direction);
+        }
+    }
+    
+    // Pressed against an obstacle: back out along the field gradient
+    if (flow_field_manager) {
+        Vector3 escape;
+        float distance = flow_field_manager->sample_obstacle_distance(position, &escape);
+        if (distance < CROWD_AGENT_RADIUS) {
+            move_direction += escape * ((CROWD_AGENT_RADIUS - distance) / CROWD_AGENT_RADIUS);
+        }
+    }
+    
+    return (move_direction + separation_force(index) * 0.3f).normalized();
+}
+
+void CrowdSystem::apply_agent(int index, float delta) {
+    Vector3 &velocity = velocities[index];
+    
+    if (!(flags[index] & AGENT_HAS_ORDER)) {
+        // Decelerate to stop
+        if (velocity.length_squared() > 0.01f) {
+            velocity = velocity.move_toward(Vector3(0, 0, 0), deceleration * delta);
+            integrate_agent(index, delta);
+        }
+        return;
+    }
+    
+    if (flags[index] & AGENT_ARRIVED) {
+        flags[index] &= ~AGENT_ARRIVED;
+        arrivals.push_back(units[index]);
+        return;
+    }
+    
+    if (avoidance_mode == AVOIDANCE_ORCA) {
+        // The solver already kept the velocity collision-free and under the agent's speed
+        velocity = avoidance_velocities[index];
+    } else {
+        apply_steering(index, delta);
+    }
+    
+    integrate_agent(index, delta);
+    
+    // Turn to face movement direction
+    if (velocity.length_squared() > 0.1f) {
+        float target_angle = Math::atan2(velocity.x, velocity.z);
+        headings[index] = Math::lerp_angle(headings[index], target_angle, turn_rate * delta);
+    }
+}
+
+void CrowdSystem::apply_steering(int index, float delta) {
+    Vector3 &velocity = velocities[index];
+    const Vector3 move_direction = desired_directions[index];
+    
+    // Steer toward the desired velocity with limited acceleration
+    const float speed = speeds[index];
+    Vector3 steering = move_direction * speed - velocity;
+    if (steering.length() > acceleration) {
+        steering = steering.normalized() * acceleration;
+    }
+    velocity += steering * delta;
+    if (velocity.length() > speed) {
+        velocity = velocity.normalized() * speed;
+    }
+}
+
+void CrowdSystem::integrate_agent(int index, float delta) {
+    Vector3 &position = positions[index];
+    Vector3 &velocity = velocities[index];
+    Vector3 motion = Vector3(velocity.x, 0, velocity.z) * delta;
+    Vector3 next = position + motion;
+    
+    // Bodies are no longer moved by the physics server, so blocked cells stop them instead;
+    // slide along whichever axis stays open. Units already off the grid are not held back.
+    if (flow_field_manager && flow_field_manager->is_position_walkable(position) && !flow_field_manager->is_position_walkable(next)) {
+        Vector3 slide_x = position + Vector3(motion.x, 0, 0);
+        Vector3 slide_z = position + Vector3(0, 0, motion.z);
+        if (flow_field_manager->is_position_walkable(slide_x)) {
+            next = slide_x;
+            velocity.z = 0;
+        } else if (flow_field_manager->is_position_walkable(slide_z)) {
+            next = slide_z;
+            velocity.x = 0;
+        } else {
+            next = position;
+            velocity = Vector3(0, 0, 0);
+        }
+    }
+    
+    position = next;
+    snap_agent_to_terrain(index, delta);
+    flags[index] |= AGENT_MOVED;
+}
+
+void CrowdSystem::snap_agent_to_terrain(int index, float delta) {
+    if (!terrain) return;
+    
+    Vector3 &position = positions[index];
+    
+    // Out of bounds - push back inside, 5 units from the edge
+    if (!terrain->is_within_bounds(position.x, position.z)) {
+        float half_size = terrain->get_world_size() * 0.5f - 5.0f;
+        position.x = Math::clamp(position.x, -half_size, half_size);
+        position.z = Math::clamp(position.z, -half_size, half_size);
+    }
+    
+    float last_height = position.y;
+    position.y = terrain->get_height_at(position.x, position.z);
+    
+    // Slow down uphill and speed up downhill, by rise over run this tick
+    const Vector3 &velocity = velocities[index];
+    float horizontal_speed = Vector2(velocity.x, velocity.z).length();
+    if (horizontal_speed > 0.1f && delta > 0.0f) {
+        float slope = Math::clamp((position.y - last_height) / (horizontal_speed * delta), -1.0f, 1.0f);
+        const float base_speed = base_speeds[index];
+        if (slope > 0.05f) {
+            float slope_factor = 1.0f - (slope * (1.0f - uphill_speed_multiplier));
+            speeds[index] = base_speed * Math::max(slope_factor, uphill_speed_multiplier);
+        } else if (slope < -0.05f) {
+            float slope_factor = 1.0f + (-slope * (downhill_speed_multiplier - 1.0f));
+            speeds[index] = base_speed * Math::min(slope_factor, downhill_speed_multiplier);
+        } else {
+            speeds[index] = base_speed;
+        }
+    }
+}
+
+void CrowdSystem::animate_agent(int index, float delta) {
+    MeshInstance3D *mesh = meshes[index];
+    if (!mesh) return;
+    
+    float speed = velocities[index].length();
+    
+    if (speed > 0.5f) {
+        // Two bobs per stride, a sway per stride, and a slight forward lean under orders
+        float ratio = speed / Math::max(speeds[index], 0.01f);
+        walk_times[index] += delta * walk_bob_speed * ratio;
+        float bob_y = Math::sin(walk_times[index] * 2.0f) * walk_bob_amount * ratio;
+        float sway_x = Math::sin(walk_times[index]) * walk_sway_amount * ratio;
+        float lean = (flags[index] & AGENT_HAS_ORDER) ? 0.05f : 0.0f;
+    
+        // 0.5 is the mesh's resting offset in the unit scene
+        mesh->set_transform(Transform3D(Basis::from_euler(Vector3(lean, 0, -sway_x * 2.0f)), Vector3(sway_x, 0.5f + bob_y, 0)));
+        flags[index] |= AGENT_POSED;
+    } else if (flags[index] & AGENT_POSED) {
+        // Ease back to the rest pose, then leave the mesh alone
+        walk_times[index] = 0.0f;
+    
+        float blend = Math::min(delta * 10.0f, 1.0f);
+        Vector3 mesh_pos = mesh->get_position();
+        Vector3 mesh_rot = mesh->get_rotation();
+        mesh_pos.x = Math::lerp(mesh_pos.x, 0.0f, blend);
+        mesh_pos.y = Math::lerp(mesh_pos.y, 0.5f, blend);
+        mesh_rot.x = Math::lerp(mesh_rot.x, 0.0f, blend);
+        mesh_rot.z = Math::lerp(mesh_rot.z, 0.0f, blend);
+    
+        if (Math::abs(mesh_pos.y - 0.5f) < 0.001f && Math::abs(mesh_rot.x) < 0.001f && Math::abs(mesh_rot.z) < 0.001f) {
+            mesh_pos = Vector3(0, 0.5f, 0);
+            mesh_rot = Vector3(0, 0, 0);
+            flags[index] &= ~AGENT_POSED;
+        }
+        mesh->set_transform(Transform3D(Basis::from_euler(mesh_rot), mesh_pos));
+    }
+}
+
+Vector3 CrowdSystem::solve_orca_velocity(int index, const Vector3 &preferred_velocity) const {
+    const Vector3 position3 = positions[index];
+    const Vector2 position = Vector2(position3.x, position3.z);
+    const Vector2 velocity = Vector2(velocities[index].x, velocities[index].z);
+    const float max_speed = speeds[index];
+    const float inv_time_horizon = 1.0f / orca_time_horizon;
+    const float inv_time_step = 1.0f / Math::max(steering_delta, 0.001f);
+    
+    OrcaLine lines[ORCA_MAX_LINES];
+    int line_count = 0;
+    
+    // Buildings: the half-plane facing the nearest point of each of the nearest footprints in range
+    struct Obstacle {
+        float distance;                   // Signed; negative when the agent's centre is inside
+        Vector2 normal;                   // Towards the footprint
+    };
+    Obstacle obstacles[ORCA_MAX_OBSTACLES];
+    int obstacle_count = 0;
+    
+    if (flow_field_manager) {
+        flow_field_manager->for_each_footprint_near(position3, orca_neighbor_distance, [&](const BuildingFootprint &footprint) {
+            const float half_size = footprint.size * 0.5f;
+            const Vector2 center = Vector2(footprint.position.x, footprint.position.z);
+            Vector2 nearest = Vector2(
+                Math::clamp(position.x, center.x - half_size, center.x + half_size),
+                Math::clamp(position.y, center.y - half_size, center.y + half_size));
+            Vector2 to_nearest = nearest - position;
+            
+            Obstacle obstacle;
+            obstacle.distance = to_nearest.length();
+            if (obstacle.distance > ORCA_EPSILON) {
+                obstacle.normal = to_nearest / obstacle.distance;
+            } else {
+                // Centre inside the base: face the closest edge so the agent is pushed out through it
+                const Vector2 offset = position - center;
+                const float depth_x = half_size - Math::abs(offset.x);
+                const float depth_z = half_size - Math::abs(offset.y);
+                if (depth_x < depth_z) {
+                    obstacle.normal = Vector2(offset.x < 0.0f ? 1.0f : -1.0f, 0.0f);
+                    obstacle.distance = -depth_x;
+                } else {
+                    obstacle.normal = Vector2(0.0f, offset.y < 0.0f ? 1.0f : -1.0f);
+                    obstacle.distance = -depth_z;
+                }
+            }
+            if (obstacle.distance > orca_neighbor_distance) return;
+            if (obstacle_count == ORCA_MAX_OBSTACLES && obstacle.distance >= obstacles[obstacle_count - 1].distance) return;
+            
+            int slot = obstacle_count < ORCA_MAX_OBSTACLES ? obstacle_count++ : obstacle_count - 1;
+            while (slot > 0 && obstacles[slot - 1].distance > obstacle.distance) {
+                obstacles[slot] = obstacles[slot - 1];
+                slot--;
+            }
+            obstacles[slot] = obstacle;
+        });
+    }
+    
+    for (int i = 0; i < obstacle_count; i++) {
+        // Approach no faster than closes the gap within the horizon; back out at once if inside,
+        // but within the speed limit, since an infeasible building line would be dropped entirely
+        const Obstacle &obstacle = obstacles[i];
+        float gap = obstacle.distance - CROWD_AGENT_RADIUS;
+        float max_approach = gap > 0.0f ? gap * inv_time_horizon : Math::max(gap * inv_time_step, -max_speed * 0.99f);
+        
+        OrcaLine &line = lines[line_count++];
+        line.direction = Vector2(-obstacle.normal.y, obstacle.normal.x);
+        line.point = obstacle.normal * max_approach;
+    }
+    
+    // Nearest neighbours from the spatial hash, kept sorted by distance
+    struct Neighbor {
+        float distance_sq;
+        Vector2 position;
+        Vector2 velocity;
+        float radius;
+        float responsibility;
+    };
+    Neighbor neighbors[ORCA_MAX_NEIGHBORS];
+    int neighbor_count = 0;
+    
+    const Node3D *self = units[index];
+    if (spatial_hash) {
+        spatial_hash->for_each_neighbor(position3, orca_neighbor_distance, SPATIAL_LAYER_UNITS | SPATIAL_LAYER_VEHICLES,
+            [&](const SpatialHash::Entry &other, float distance_sq) {
+                if (other.node == self) return;
+                if (neighbor_count == ORCA_MAX_NEIGHBORS && distance_sq >= neighbors[neighbor_count - 1].distance_sq) return;
+                
+                Neighbor neighbor;
+                neighbor.distance_sq = distance_sq;
+                neighbor.position = Vector2(other.position.x, other.position.z);
+                neighbor.velocity = Vector2(0, 0);
+                neighbor.radius = CROWD_VEHICLE_RADIUS;
+                neighbor.responsibility = 1.0f;
+                
+                // Units register on the unit layer only; moving ones take half of each avoidance,
+                // while stopped units and vehicles are avoided entirely by this agent. Vehicles
+                // move on the main thread, never while steering runs, so their velocity is stable here
+                if (other.layer & SPATIAL_LAYER_VEHICLES) {
+                    const Vector3 vehicle_velocity = static_cast<const Vehicle *>(other.node)->get_current_velocity();
+                    neighbor.velocity = Vector2(vehicle_velocity.x, vehicle_velocity.z);
+                } else if (other.layer & SPATIAL_LAYER_UNITS) {
+                    neighbor.radius = CROWD_AGENT_RADIUS;
+                    int other_index = static_cast<const Unit *>(other.node)->get_crowd_index();
+                    if (other_index >= 0) {
+                        neighbor.velocity = Vector2(velocities[other_index].x, velocities[other_index].z);
+                        if (neighbor.velocity.length_squared() > 0.01f) {
+                            neighbor.responsibility = 0.5f;
+                        }
+                    }
+                }
+                
+                int slot = neighbor_count < ORCA_MAX_NEIGHBORS ? neighbor_count++ : neighbor_count - 1;
+                while (slot > 0 && neighbors[slot - 1].distance_sq > distance_sq) {
+                    neighbors[slot] = neighbors[slot - 1];
+                    slot--;
+                }
+                neighbors[slot] = neighbor;
+            });
+    }
+    
+    // One velocity-obstacle half-plane per neighbour
+    for (int i = 0; i < neighbor_count; i++) {
+        const Neighbor &neighbor = neighbors[i];
+        const Vector2 relative_position = neighbor.position - position;
+        const Vector2 relative_velocity = velocity - neighbor.velocity;
+        const float distance_sq = relative_position.length_squared();
+        const float combined_radius = CROWD_AGENT_RADIUS + neighbor.radius;
+        const float combined_radius_sq = combined_radius * combined_radius;
+        
+        OrcaLine &line = lines[line_count++];
+        Vector2 u;
+        
+        if (distance_sq > combined_radius_sq) {
+            // Vector from the cutoff circle's centre to the relative velocity
+            const Vector2 w = relative_velocity - relative_position * inv_time_horizon;
+            const float w_length_sq = w.length_squared();
+            const float dot_product = w.dot(relative_position);
+            
+            if (dot_product < 0.0f && dot_product * dot_product > combined_radius_sq * w_length_sq) {
+                // Nearest boundary is the cutoff circle
+                const float w_length = Math::sqrt(w_length_sq);
+                const Vector2 unit_w = w / w_length;
+                line.direction = Vector2(unit_w.y, -unit_w.x);
+                u = unit_w * (combined_radius * inv_time_horizon - w_length);
+            } else {
+                // Nearest boundary is one of the cone's legs
+                const float leg = Math::sqrt(distance_sq - combined_radius_sq);
+                if (relative_position.cross(w) > 0.0f) {
+                    line.direction = Vector2(relative_position.x * leg - relative_position.y * combined_radius,
+                        relative_position.x * combined_radius + relative_position.y * leg) / distance_sq;
+                } else {
+                    line.direction = -Vector2(relative_position.x * leg + relative_position.y * combined_radius,
+                        -relative_position.x * combined_radius + relative_position.y * leg) / distance_sq;
+                }
+                u = line.direction * relative_velocity.dot(line.direction) - relative_velocity;
+            }
+        } else {
+            // Already overlapping: resolve within this tick
+            const Vector2 w = relative_velocity - relative_position * inv_time_step;
+            const float w_length = w.length();
+            const Vector2 unit_w = w_length > ORCA_EPSILON ? w / w_length : Vector2(1, 0);
+            line.direction = Vector2(unit_w.y, -unit_w.x);
+            u = unit_w * (combined_radius * inv_time_step - w_length);
+        }
+        
+        line.point = velocity + u * neighbor.responsibility;
+    }
+    
+    Vector2 result;
+    const Vector2 preferred = Vector2(preferred_velocity.x, preferred_velocity.z);
+    int failed_line = orca_linear_program2(lines, line_count, max_speed, preferred, false, result);
+    if (failed_line < line_count) {
+        orca_linear_program3(lines, line_count, obstacle_count, failed_line, max_speed, result);
+    }
+    
+    return Vector3(result.x, 0, result.y);
+}
+
+Vector3 CrowdSystem::separation_force(int index) const {
+    Vector3 force = Vector3(0, 0, 0);
+    if (!spatial_hash) return force;
+    
+    const Vector3 position = positions[index];
+    const Node3D *self = units[index];
+    spatial_hash->for_each_neighbor(position, separation_radius, SPATIAL_LAYER_UNITS | SPATIAL_LAYER_VEHICLES,
+        [&](const SpatialHash::Entry &other, float distance_sq) {
+            if (other.node == self || distance_sq <= 0.0001f) return;
+    
+            float dist = Math::sqrt(distance_sq);
+            Vector3 away = position - other.position;
+            away.y = 0;
+            float strength = (1.0f - dist / separation_radius) * separation_strength;
+            force += (away / dist) * strength;
+        });
+    return force;
+}
+
+Vector3 CrowdSystem::find_clear_direction(int index, const Vector3 &preferred_dir) const {
+    // Context steering: score 8 directions on clearance, heading to target and momentum
+    const int num_directions = 8;
+    float best_score = -1000.0f;
+    Vector3 best_direction = preferred_dir;
+    
+    const Vector3 position = positions[index];
+    Vector3 to_target = (targets[index] - position).normalized();
+    
+    for (int i = 0; i < num_directions; i++) {
+        float angle = (i * 2.0f * Math_PI) / num_directions;
+        Vector3 dir = Vector3(Math::sin(angle), 0, Math::cos(angle));
+    
+        float clearance = obstacle_clearance(position, dir);
+    
+        float clearance_score = clearance / avoidance_radius;
+        float target_score = (dir.dot(to_target) + 1.0f) * 0.5f;     // 0 to 1
+        float momentum_score = (dir.dot(preferred_dir) + 1.0f) * 0.25f; // 0 to 0.5
+    
+        // Clearance is most important, then target direction
+        float score = clearance_score * 2.0f + target_score * 1.5f + momentum_score;
+        if (clearance < 1.0f) {
+            score -= 5.0f;
+        }
+    
+        if (score > best_score) {
+            best_score = score;
+            best_direction = dir;
+        }
+    }
+    
+    return best_direction;
+}
+
+float CrowdSystem::obstacle_clearance(const Vector3 &position, const Vector3 &direction) const {
+    // Without a nav grid there is no obstacle data; treat the way as open
+    if (!flow_field_manager) return avoidance_radius;
+    return flow_field_manager->trace_obstacle_distance(position, direction, avoidance_radius, CROWD_AGENT_RADIUS);
+}
+
+void CrowdSystem::set_acceleration(float value) {
+    acceleration = Math::clamp(value, 1.0f, 100.0f);
+}
+
+float CrowdSystem::get_acceleration() const {
+    return acceleration;
+}
+
+void CrowdSystem::set_deceleration(float value) {
+    deceleration = Math::clamp(value, 1.0f, 100.0f);
+}
+
+float CrowdSystem::get_deceleration() const {
+    return deceleration;
+}
+
+void CrowdSystem::set_turn_rate(float value) {
+    turn_rate = Math::clamp(value, 0.5f, 30.0f);
+}
+
+float CrowdSystem::get_turn_rate() const {
+    return turn_rate;
+}
+
+void CrowdSystem::set_arrival_threshold(float value) {
+    arrival_threshold = Math::clamp(value, 0.1f, 5.0f);
+}
+
+float CrowdSystem::get_arrival_threshold() const {
+    return arrival_threshold;
+}
+
+void CrowdSystem::set_avoidance_radius(float value) {
+    avoidance_radius = Math::clamp(value, 1.0f, 20.0f);
+}
+
+float CrowdSystem::get_avoidance_radius() const {
+    return avoidance_radius;
+}
+
+void CrowdSystem::set_separation_radius(float value) {
+    separation_radius = Math::clamp(value, 0.2f, 5.0f);
+}
+
+float CrowdSystem::get_separation_radius() const {
+    return separation_radius;
+}
+
+void CrowdSystem::set_separation_strength(float value) {
+    separation_strength = Math::clamp(value, 0.0f, 50.0f);
+}
+
+float CrowdSystem::get_separation_strength() const {
+    return separation_strength;
+}
+
+Dictionary CrowdSystem::benchmark_steering(int iterations) {
+    Dictionary results;
+    Time *time = Time::get_singleton();
+    iterations = iterations < 1 ? 1 : iterations;
+    
+    // Steering advances path points and sets arrival and avoidance flags, so every timed
+    // pass starts from the same snapshot and the agents are left as they were
+    const int count = static_cast<int>(units.size());
+    const std::vector<uint8_t> saved_flags = flags;
+    const std::vector<Vector3> saved_directions = desired_directions;
+    const std::vector<Vector3> saved_avoidance = avoidance_velocities;
+    std::vector<int> saved_path_indices(count);
+    for (int i = 0; i < count; i++) {
+        saved_path_indices[i] = units[i]->get_path_index();
+    }
+    auto time_passes = [&](int max_workers) {
+        uint64_t elapsed = 0;
+        for (int pass = 0; pass < iterations; pass++) {
+            uint64_t start = time->get_ticks_usec();
+            run_steering_phase(max_workers);
+            elapsed += time->get_ticks_usec() - start;
+            
+            flags = saved_flags;
+            for (int i = 0; i < count; i++) {
+                units[i]->set_path_index(saved_path_indices[i]);
+            }
+        }
+        return elapsed / 1000.0f / iterations;
+    };
+    
+    // Times the steering phase alone on the current agents, serially and then with
+    // doubling worker counts up to the core count
+    bool threaded = use_threaded_steering;
+    use_threaded_steering = false;
+    float serial_ms = time_passes(-1);
+    results["agents"] = get_agent_count();
+    results["serial_ms"] = serial_ms;
+    
+    use_threaded_steering = true;
+    int cores = OS::get_singleton()->get_processor_count();
+    for (int workers = 1; workers <= cores; workers *= 2) {
+        float ms = time_passes(workers);
+        
+        Dictionary entry;
+        entry["ms"] = ms;
+        entry["speedup"] = ms > 0.0f ? serial_ms / ms : 0.0f;
+        results[workers] = entry;
+    }
+    use_threaded_steering = threaded;
+    desired_directions = saved_directions;
+    avoidance_velocities = saved_avoidance;
+    
+    return results;
+}
+
+void CrowdSystem::set_avoidance_mode(int mode) {
+    avoidance_mode = static_cast<AvoidanceMode>(Math::clamp(mode, 0, 1));
+}
+
+int CrowdSystem::get_avoidance_mode() const {
+    return avoidance_mode;
+}
+
+void CrowdSystem::set_orca_time_horizon(float seconds) {
+    orca_time_horizon = Math::clamp(seconds, 0.25f, 10.0f);
+}
+
+float CrowdSystem::get_orca_time_horizon() const {
+    return orca_time_horizon;
+}
+
+void CrowdSystem::set_orca_neighbor_distance(float distance) {
+    orca_neighbor_distance = Math::clamp(distance, 1.0f, 20.0f);
+}
+
+float CrowdSystem::get_orca_neighbor_distance() const {
+    return orca_neighbor_distance;
+}
+
+void CrowdSystem::set_use_threaded_steering(bool enabled) {
+    use_threaded_steering = enabled;
+}
+
+bool CrowdSystem::get_use_threaded_steering() const {
+    return use_threaded_steering;
+}
+
+float CrowdSystem::get_last_update_ms() const {
+    return last_update_ms;
+}
+
+} // namespace rts
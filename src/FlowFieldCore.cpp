@@ -0,0 +1,531 @@
+/**
+ * FlowFieldCore.cpp
+ * Godot-free flow field kernels shared by FlowFieldManager and the benchmark.
+ */
+
+#include "FlowFieldCore.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <queue>
+
+namespace rts {
+
+void FlowGrid::resize(int w, int h) {
+    width = w;
+    height = h;
+    costs.assign(static_cast<size_t>(w) * h, FLOW_COST_DEFAULT);
+    max_cost = FLOW_COST_DEFAULT;
+    // All cells start walkable; trailing bits of the last word are never read
+    walkable_bits.assign((static_cast<size_t>(w) * h + 63) / 64, ~uint64_t(0));
+}
+
+size_t FlowGrid::memory_usage() const {
+    return costs.capacity() * sizeof(uint8_t) + walkable_bits.capacity() * sizeof(uint64_t);
+}
+
+// Flags the passable stop cells and returns how many distinct ones there are
+static int mark_stop_cells(const std::vector<uint64_t> &passable, const std::vector<int> &stop_cells, std::vector<uint64_t> &stop_bits) {
+    if (stop_cells.empty()) {
+        return 0;
+    }
+    
+    int count = 0;
+    stop_bits.assign(passable.size(), 0);
+    for (int cell : stop_cells) {
+        if (is_bit_set(passable, cell) && !is_bit_set(stop_bits, cell)) {
+            stop_bits[cell >> 6] |= uint64_t(1) << (cell & 63);
+            count++;
+        }
+    }
+    return count;
+}
+
+// Dijkstra over a binary heap; stale entries are skipped when popped.
+// Once every stop cell is settled the search runs on for stop_margin and then stops;
+// the returned limit is the largest settled value (FLT_MAX = every reachable cell settled).
+float integrate_heap(const FlowGrid &grid, const std::vector<uint64_t> &passable, std::vector<float> &integration, const std::vector<int> &targets,
+        const std::vector<int> &stop_cells, float stop_margin) {
+    const int width = grid.width;
+    const int height = grid.height;
+    
+    // Neighbor offsets in the flat arrays
+    int offsets[FLOW_DIR_COUNT];
+    for (int i = 0; i < FLOW_DIR_COUNT; i++) {
+        offsets[i] = FLOW_DY[i] * width + FLOW_DX[i];
+    }
+    
+    // Priority queue: (distance, cell index)
+    typedef std::pair<float, int> OpenEntry;
+    std::priority_queue<OpenEntry, std::vector<OpenEntry>, std::greater<OpenEntry>> open_set;
+    
+    // Every goal is a source at distance zero; cells settle toward the nearest one
+    for (int target_index : targets) {
+        integration[target_index] = 0;
+        open_set.push(OpenEntry(0.0f, target_index));
+    }
+    
+    std::vector<uint64_t> stop_bits;
+    int stops_left = mark_stop_cells(passable, stop_cells, stop_bits);
+    float settle_limit = FLT_MAX;
+    
+    while (!open_set.empty()) {
+        OpenEntry entry = open_set.top();
+        open_set.pop();
+        
+        float dist = entry.first;
+        int index = entry.second;
+        
+        // Skip if we've found a better path
+        if (dist > integration[index]) {
+            continue;
+        }
+        
+        if (dist > settle_limit) {
+            integration[index] = FLT_MAX;
+            break;
+        }
+        if (stops_left > 0 && is_bit_set(stop_bits, index)) {
+            stop_bits[index >> 6] &= ~(uint64_t(1) << (index & 63));
+            if (--stops_left == 0) {
+                settle_limit = dist + stop_margin;
+            }
+        }
+        
+        int x = index % width;
+        int y = index / width;
+        bool interior = x > 0 && x < width - 1 && y > 0 && y < height - 1;
+        
+        // Check all neighbors
+        for (int i = 0; i < FLOW_DIR_COUNT; i++) {
+            if (!interior && !neighbor_in_bounds(grid, x, y, i)) continue;
+            
+            int n = index + offsets[i];
+            if (!is_bit_set(passable, n)) continue;
+            
+            float new_dist = dist + FLOW_STEP_COST[i] * grid.costs[n];
+            
+            if (new_dist < integration[n]) {
+                integration[n] = new_dist;
+                open_set.push(OpenEntry(new_dist, n));
+            }
+        }
+    }
+    
+    // Cells only reached tentatively past the limit are left unsettled
+    if (settle_limit != FLT_MAX) {
+        while (!open_set.empty()) {
+            int index = open_set.top().second;
+            open_set.pop();
+            if (integration[index] > settle_limit) {
+                integration[index] = FLT_MAX;
+            }
+        }
+    }
+    return settle_limit;
+}
+
+// Dial's algorithm: integer edge weights are bounded, so a circular array of
+// (max_weight + 1) buckets replaces the heap and every operation is O(1)
+float integrate_dial(const FlowGrid &grid, const std::vector<uint64_t> &passable, std::vector<float> &integration, const std::vector<int> &targets,
+        const std::vector<int> &stop_cells, float stop_margin) {
+    const int width = grid.width;
+    const int height = grid.height;
+    
+    int offsets[FLOW_DIR_COUNT];
+    for (int i = 0; i < FLOW_DIR_COUNT; i++) {
+        offsets[i] = FLOW_DY[i] * width + FLOW_DX[i];
+    }
+    
+    // Bucket count only needs to cover the heaviest edge present
+    const uint32_t bucket_count = FLOW_STEP_COST_FIXED[0] * grid.max_cost + 1;
+    std::vector<std::vector<int>> buckets(bucket_count);
+    
+    // Distances are kept in fixed-point units directly in the integration array (exact
+    // below 2^24) and rescaled for the settled cells only, so work scales with the area reached
+    std::vector<float> &dist = integration;
+    std::vector<int> settled;
+    
+    for (int target_index : targets) {
+        dist[target_index] = 0;
+        buckets[0].push_back(target_index);
+    }
+    size_t pending = buckets[0].size();
+    
+    std::vector<uint64_t> stop_bits;
+    int stops_left = mark_stop_cells(passable, stop_cells, stop_bits);
+    uint32_t settle_limit = UINT32_MAX;
+    
+    for (uint32_t current = 0; pending > 0 && current <= settle_limit; current++) {
+        // Edge weights are never zero, so relaxations never land in the active bucket
+        std::vector<int> &bucket = buckets[current % bucket_count];
+        
+        while (!bucket.empty()) {
+            int index = bucket.back();
+            bucket.pop_back();
+            pending--;
+            
+            // Stale entry; the cell was settled at a smaller distance
+            if (dist[index] != static_cast<float>(current)) continue;
+            settled.push_back(index);
+            
+            if (stops_left > 0 && is_bit_set(stop_bits, index)) {
+                stop_bits[index >> 6] &= ~(uint64_t(1) << (index & 63));
+                if (--stops_left == 0) {
+                    settle_limit = current + static_cast<uint32_t>(stop_margin * FLOW_FIXED_SCALE + 0.5f);
+                }
+            }
+            
+            int x = index % width;
+            int y = index / width;
+            bool interior = x > 0 && x < width - 1 && y > 0 && y < height - 1;
+            
+            for (int i = 0; i < FLOW_DIR_COUNT; i++) {
+                if (!interior && !neighbor_in_bounds(grid, x, y, i)) continue;
+                
+                int n = index + offsets[i];
+                if (!is_bit_set(passable, n)) continue;
+                
+                uint32_t new_dist = current + FLOW_STEP_COST_FIXED[i] * grid.costs[n];
+                
+                if (static_cast<float>(new_dist) < dist[n]) {
+                    dist[n] = static_cast<float>(new_dist);
+                    buckets[new_dist % bucket_count].push_back(n);
+                    pending++;
+                }
+            }
+        }
+    }
+    
+    // Cells only reached tentatively past the limit are left unsettled
+    if (settle_limit != UINT32_MAX) {
+        for (const std::vector<int> &bucket : buckets) {
+            for (int index : bucket) {
+                if (dist[index] > static_cast<float>(settle_limit)) {
+                    dist[index] = FLT_MAX;
+                }
+            }
+        }
+    }
+    
+    // Convert back to cell units so both engines produce comparable values
+    for (int index : settled) {
+        integration[index] = dist[index] / FLOW_FIXED_SCALE;
+    }
+    return settle_limit == UINT32_MAX ? FLT_MAX : settle_limit / FLOW_FIXED_SCALE;
+}
+
+// A reachable cell points at its lowest-cost passable neighbor
+uint8_t compute_cell_direction(const FlowGrid &grid, const std::vector<uint64_t> &passable,
+        const std::vector<float> &integration, int x, int y) {
+    int index = y * grid.width + x;
+    if (!is_bit_set(passable, index) || integration[index] == FLT_MAX) {
+        return FLOW_DIR_NONE;
+    }
+    
+    bool interior = x > 0 && x < grid.width - 1 && y > 0 && y < grid.height - 1;
+    float min_dist = integration[index];
+    uint8_t direction = FLOW_DIR_NONE;
+    
+    for (int i = 0; i < FLOW_DIR_COUNT; i++) {
+        if (!interior && !neighbor_in_bounds(grid, x, y, i)) continue;
+        
+        int n = index + FLOW_DY[i] * grid.width + FLOW_DX[i];
+        if (!is_bit_set(passable, n)) continue;
+        
+        if (integration[n] < min_dist) {
+            min_dist = integration[n];
+            direction = static_cast<uint8_t>(i);
+        }
+    }
+    
+    return direction;
+}
+
+void build_directions(const FlowGrid &grid, const std::vector<uint64_t> &passable, const std::vector<float> &integration,
+        std::vector<uint8_t> &directions, const std::vector<CellRect> &regions) {
+    for (const CellRect &rect : regions) {
+        for (int y = rect.y0; y < rect.y1; y++) {
+            for (int x = rect.x0; x < rect.x1; x++) {
+                directions[y * grid.width + x] = compute_cell_direction(grid, passable, integration, x, y);
+            }
+        }
+    }
+}
+
+// Marks cells whose straight line to the target crosses only open, default-cost cells.
+// Rings of growing Chebyshev distance are swept outward; a cell inherits visibility from
+// the one or two cells its line passes through one ring closer, so each cell is O(1).
+// Straddled lines need both cells visible, which keeps the result conservative.
+void compute_line_of_sight(const FlowGrid &grid, const std::vector<uint64_t> &passable, int target_index,
+        std::vector<uint64_t> &los) {
+    los.assign(passable.size(), 0);
+    
+    const int width = grid.width;
+    const int height = grid.height;
+    const int gx = target_index % width;
+    const int gy = target_index / width;
+    los[target_index >> 6] |= uint64_t(1) << (target_index & 63);
+    
+    auto visible = [&](int x, int y) {
+        return is_bit_set(los, y * width + x);
+    };
+    
+    auto visit = [&](int x, int y) {
+        int index = y * width + x;
+        if (!is_bit_set(passable, index) || grid.costs[index] != FLOW_COST_DEFAULT) {
+            return false;
+        }
+        
+        int dx = x - gx;
+        int dy = y - gy;
+        int ax = std::abs(dx);
+        int ay = std::abs(dy);
+        int sx = dx > 0 ? 1 : -1;
+        int sy = dy > 0 ? 1 : -1;
+        bool seen;
+        
+        if (ax >= ay) {
+            // Where the line crosses the previous column
+            int px = x - sx;
+            int num = ay * (ax - 1);
+            int py = gy + sy * (num / ax);
+            seen = visible(px, py) && (num % ax == 0 || visible(px, py + sy));
+        } else {
+            int py = y - sy;
+            int num = ax * (ay - 1);
+            int px = gx + sx * (num / ay);
+            seen = visible(px, py) && (num % ay == 0 || visible(px + sx, py));
+        }
+        
+        if (seen) {
+            los[index >> 6] |= uint64_t(1) << (index & 63);
+        }
+        return seen;
+    };
+    
+    const int max_ring = std::max(std::max(gx, width - 1 - gx), std::max(gy, height - 1 - gy));
+    for (int ring = 1; ring <= max_ring; ring++) {
+        bool any = false;
+        int x0 = gx - ring;
+        int x1 = gx + ring;
+        int y0 = gy - ring;
+        int y1 = gy + ring;
+        
+        // Top and bottom rows, then the left and right columns between them
+        for (int x = std::max(x0, 0); x <= std::min(x1, width - 1); x++) {
+            if (y0 >= 0) any |= visit(x, y0);
+            if (y1 < height) any |= visit(x, y1);
+        }
+        for (int y = std::max(y0 + 1, 0); y <= std::min(y1 - 1, height - 1); y++) {
+            if (x0 >= 0) any |= visit(x0, y);
+            if (x1 < width) any |= visit(x1, y);
+        }
+        
+        // Nothing further out can see past a fully blocked ring
+        if (!any) {
+            break;
+        }
+    }
+}
+
+size_t PathScratch::memory_usage() const {
+    return nodes.capacity() * sizeof(Node) + open.capacity() * sizeof(OpenEntry);
+}
+
+bool segment_clear(const FlowGrid &grid, const std::vector<uint64_t> &passable, int from, int to, uint8_t max_cost) {
+    int x0 = from % grid.width;
+    int y0 = from / grid.width;
+    int x1 = to % grid.width;
+    int y1 = to / grid.width;
+    int dx = std::abs(x1 - x0);
+    int dy = std::abs(y1 - y0);
+    int sx = x0 < x1 ? 1 : -1;
+    int sy = y0 < y1 ? 1 : -1;
+    int err = dx - dy;
+    
+    while (x0 != x1 || y0 != y1) {
+        int e2 = 2 * err;
+        bool step_x = e2 > -dy;
+        bool step_y = e2 < dx;
+        if (step_x && step_y &&
+                !is_bit_set(passable, y0 * grid.width + x0 + sx) && !is_bit_set(passable, (y0 + sy) * grid.width + x0)) {
+            return false;
+        }
+        if (step_x) {
+            err -= dy;
+            x0 += sx;
+        }
+        if (step_y) {
+            err += dx;
+            y0 += sy;
+        }
+        
+        int index = y0 * grid.width + x0;
+        if (!is_bit_set(passable, index) || grid.costs[index] > max_cost) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Octile distance; every passable cell costs at least FLOW_COST_DEFAULT, so this never overestimates
+static inline float octile_distance(int dx, int dy) {
+    dx = std::abs(dx);
+    dy = std::abs(dy);
+    int diagonal = std::min(dx, dy);
+    return FLOW_STEP_COST[1] * (std::max(dx, dy) - diagonal) + FLOW_STEP_COST[0] * diagonal;
+}
+
+bool find_path_astar(const FlowGrid &grid, const std::vector<uint64_t> &passable, int start, int goal,
+        PathScratch &scratch, std::vector<int> &path, float heuristic_weight, int max_expansions) {
+    path.clear();
+    if (!is_bit_set(passable, start) || !is_bit_set(passable, goal)) {
+        return false;
+    }
+    
+    const int width = grid.width;
+    const int height = grid.height;
+    const size_t cell_count = static_cast<size_t>(width) * height;
+    if (scratch.nodes.size() != cell_count) {
+        scratch.nodes.assign(cell_count, PathScratch::Node());
+        scratch.generation = 0;
+    }
+    
+    // Stamps from earlier searches become stale; on wrap-around they are cleared once
+    if (++scratch.generation == 0) {
+        std::fill(scratch.nodes.begin(), scratch.nodes.end(), PathScratch::Node());
+        scratch.generation = 1;
+    }
+    const uint32_t generation = scratch.generation;
+    PathScratch::Node *nodes = scratch.nodes.data();
+    
+    int offsets[FLOW_DIR_COUNT];
+    for (int i = 0; i < FLOW_DIR_COUNT; i++) {
+        offsets[i] = FLOW_DY[i] * width + FLOW_DX[i];
+    }
+    const int goal_x = goal % width;
+    const int goal_y = goal / width;
+    
+    // Lowest f first; among equal f the entry closer to the goal, which keeps straight runs from fanning out
+    auto later = [](const PathScratch::OpenEntry &a, const PathScratch::OpenEntry &b) {
+        return a.f > b.f || (a.f == b.f && a.h > b.h);
+    };
+    
+    std::vector<PathScratch::OpenEntry> &open = scratch.open;
+    open.clear();
+    nodes[start].cost = 0.0f;
+    nodes[start].parent = -1;
+    nodes[start].generation = generation;
+    float start_h = octile_distance(start % width - goal_x, start / width - goal_y) * heuristic_weight;
+    open.push_back({start_h, start_h, start});
+    
+    int expansions = 0;
+    while (!open.empty()) {
+        std::pop_heap(open.begin(), open.end(), later);
+        int index = open.back().index;
+        open.pop_back();
+        
+        PathScratch::Node &node = nodes[index];
+        if (node.closed == generation) continue;
+        node.closed = generation;
+        
+        if (index == goal) {
+            for (int cell = goal; cell != -1; cell = nodes[cell].parent) {
+                path.push_back(cell);
+            }
+            std::reverse(path.begin(), path.end());
+            return true;
+        }
+        if (max_expansions > 0 && ++expansions > max_expansions) {
+            return false;
+        }
+        
+        // Leaving a cell costs what the integration charges for entering it from the goal side,
+        // so a path's cost equals the field's integration value at its start
+        const float g = node.cost;
+        const float cell_cost = grid.costs[index];
+        const int x = index % width;
+        const int y = index / width;
+        const bool interior = x > 0 && x < width - 1 && y > 0 && y < height - 1;
+        
+        for (int i = 0; i < FLOW_DIR_COUNT; i++) {
+            if (!interior && !neighbor_in_bounds(grid, x, y, i)) continue;
+            
+            int n = index + offsets[i];
+            if (!is_bit_set(passable, n)) continue;
+            
+            PathScratch::Node &next = nodes[n];
+            float new_cost = g + FLOW_STEP_COST[i] * cell_cost;
+            if (next.generation != generation || (next.closed != generation && new_cost < next.cost)) {
+                next.generation = generation;
+                next.cost = new_cost;
+                next.parent = index;
+                
+                float h = octile_distance(x + FLOW_DX[i] - goal_x, y + FLOW_DY[i] - goal_y) * heuristic_weight;
+                open.push_back({new_cost + h, h, n});
+                std::push_heap(open.begin(), open.end(), later);
+            }
+        }
+    }
+    return false;
+}
+
+void smooth_path(const FlowGrid &grid, const std::vector<uint64_t> &passable, std::vector<int> &path) {
+    if (path.size() < 3) {
+        return;
+    }
+    
+    // Highest cost among the cells a shortcut from path[anchor] to path[end] would replace
+    auto replaced_cost = [&](size_t anchor, size_t end) {
+        uint8_t cost = FLOW_COST_DEFAULT;
+        for (size_t i = anchor + 1; i <= end; i++) {
+            cost = std::max(cost, grid.costs[path[i]]);
+        }
+        return cost;
+    };
+    auto shortcut_clear = [&](size_t anchor, size_t end) {
+        return segment_clear(grid, passable, path[anchor], path[end], replaced_cost(anchor, end));
+    };
+    
+    std::vector<int> pulled;
+    pulled.push_back(path[0]);
+    size_t anchor = 0;
+    const size_t last = path.size() - 1;
+    
+    while (anchor < last) {
+        // Gallop outward while shortcuts stay clear, then bisect back to the farthest clear one;
+        // a skipped clear cell only costs a slightly longer path, never an invalid one
+        size_t reach = anchor + 1;
+        size_t step = 1;
+        size_t blocked = last + 1;
+        while (reach + step <= last) {
+            if (!shortcut_clear(anchor, reach + step)) {
+                blocked = reach + step;
+                break;
+            }
+            reach += step;
+            step *= 2;
+        }
+        if (blocked == last + 1 && reach < last && shortcut_clear(anchor, last)) {
+            reach = last;
+        } else {
+            size_t high = std::min(blocked, last + 1);
+            while (high - reach > 1) {
+                size_t middle = reach + (high - reach) / 2;
+                if (shortcut_clear(anchor, middle)) {
+                    reach = middle;
+                } else {
+                    high = middle;
+                }
+            }
+        }
+        
+        pulled.push_back(path[reach]);
+        anchor = reach;
+    }
+    path.swap(pulled);
+}
+
+} // namespace rts
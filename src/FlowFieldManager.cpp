@@ -4,32 +4,224 @@
  */
 
 #include "FlowFieldManager.h"
+#include "TerrainGenerator.h"
 
+#include <godot_cpp/classes/dir_access.hpp>
 #include <godot_cpp/classes/engine.hpp>
+#include <godot_cpp/classes/file_access.hpp>
 #include <godot_cpp/classes/viewport.hpp>
-#include <godot_cpp/classes/world3d.hpp>
 #include <godot_cpp/classes/scene_tree.hpp>
 #include <godot_cpp/classes/window.hpp>
-#include <godot_cpp/classes/physics_direct_space_state3d.hpp>
-#include <godot_cpp/classes/physics_ray_query_parameters3d.hpp>
 #include <godot_cpp/classes/immediate_mesh.hpp>
 #include <godot_cpp/classes/mesh_instance3d.hpp>
 #include <godot_cpp/classes/standard_material3d.hpp>
+#include <godot_cpp/classes/time.hpp>
+#include <godot_cpp/classes/worker_thread_pool.hpp>
 #include <godot_cpp/variant/utility_functions.hpp>
 
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
 using namespace godot;
 
 namespace rts {
 
+// World-space unit vector for each packed direction (last entry = FLOW_DIR_NONE)
+static const Vector3 FLOW_DIR_VECTORS[FLOW_DIR_COUNT + 1] = {
+    Vector3(-0.70710678f, 0, -0.70710678f), Vector3(0, 0, -1), Vector3(0.70710678f, 0, -0.70710678f),
+    Vector3(-1, 0, 0), Vector3(1, 0, 0),
+    Vector3(-0.70710678f, 0, 0.70710678f), Vector3(0, 0, 1), Vector3(0.70710678f, 0, 0.70710678f),
+    Vector3(0, 0, 0)
+};
+
+// Matches TerrainGenerator::is_buildable_at: cells this close above water are rough ground
+static const float SHORELINE_HEIGHT = 0.5f;
+
+// Packed direction components split out for the batched sampler (last entry = FLOW_DIR_NONE)
+static const float FLOW_DIR_X[FLOW_DIR_COUNT + 1] = {-0.70710678f, 0, 0.70710678f, -1, 1, -0.70710678f, 0, 0.70710678f, 0};
+static const float FLOW_DIR_Z[FLOW_DIR_COUNT + 1] = {-0.70710678f, -1, -0.70710678f, 0, 0, 0.70710678f, 1, 0.70710678f, 0};
+
+// Positions sampled per block in get_flow_directions
+static const int FLOW_SAMPLE_BLOCK = 64;
+
+// Portal runs longer than this get an entrance at each end instead of one in the middle
+static const int MAX_SINGLE_ENTRANCE_LENGTH = 8;
+
+// Cells traced at most by get_flow_lookahead_point, and how far it looks to rejoin the field
+static const int MAX_LOOKAHEAD_STEPS = 32;
+static const int LOOKAHEAD_RECOVERY_RADIUS = 2;
+
+// Path endpoints inside an obstacle or clearance margin snap to an open cell this close
+static const int PATH_ENDPOINT_RECOVERY_RADIUS = 2;
+
+// Obstacle distances are exact up to this many cells and clamped beyond it
+static const int OBSTACLE_DISTANCE_CAP = 8;
+
+// Sphere-traced obstacle rays give up after this many samples
+static const int OBSTACLE_TRACE_MAX_STEPS = 16;
+
+// Static field files: "FLOW" magic and format version
+static const uint32_t STATIC_FIELD_MAGIC = 0x574F4C46;
+static const uint32_t STATIC_FIELD_VERSION = 1;
+
+// Pinned fields beyond this many deferred changes per cell are re-integrated instead of repaired
+static const int STATIC_FIELD_REBUILD_DIVISOR = 16;
+
+// Length-prefixed raw dump of a flat array
+template <typename T>
+static void store_array(const Ref<FileAccess> &file, const std::vector<T> &values) {
+    PackedByteArray bytes;
+    bytes.resize(values.size() * sizeof(T));
+    if (!values.empty()) {
+        memcpy(bytes.ptrw(), values.data(), bytes.size());
+    }
+    file->store_32(static_cast<uint32_t>(values.size()));
+    file->store_buffer(bytes);
+}
+
+template <typename T>
+static bool load_array(const Ref<FileAccess> &file, std::vector<T> &values, size_t expected_count) {
+    uint32_t count = file->get_32();
+    if (count != expected_count) {
+        return false;
+    }
+    
+    PackedByteArray bytes = file->get_buffer(static_cast<int64_t>(count) * sizeof(T));
+    if (bytes.size() != static_cast<int64_t>(count * sizeof(T))) {
+        return false;
+    }
+    values.resize(count);
+    if (count > 0) {
+        memcpy(values.data(), bytes.ptr(), bytes.size());
+    }
+    return true;
+}
+
+// Dial's algorithm confined to one rectangle; distances are indexed locally
+// ((y - y0) * w + (x - x0)) and returned in cell units
+static void integrate_local(const FlowGrid &grid, const CellRect &rect, int source_cell, std::vector<float> &local) {
+    const int local_width = rect.x1 - rect.x0;
+    const int local_height = rect.y1 - rect.y0;
+    local.assign(local_width * local_height, FLT_MAX);
+    
+    int source_x = source_cell % grid.width - rect.x0;
+    int source_y = source_cell / grid.width - rect.y0;
+    int source_index = source_y * local_width + source_x;
+    
+    const uint32_t bucket_count = FLOW_STEP_COST_FIXED[0] * grid.max_cost + 1;
+    std::vector<std::vector<int>> buckets(bucket_count);
+    
+    local[source_index] = 0;
+    buckets[0].push_back(source_index);
+    size_t pending = 1;
+    
+    for (uint32_t current = 0; pending > 0; current++) {
+        std::vector<int> &bucket = buckets[current % bucket_count];
+        
+        while (!bucket.empty()) {
+            int index = bucket.back();
+            bucket.pop_back();
+            pending--;
+            
+            if (local[index] != static_cast<float>(current)) continue;
+            
+            int lx = index % local_width;
+            int ly = index / local_width;
+            
+            for (int i = 0; i < FLOW_DIR_COUNT; i++) {
+                int nx = lx + FLOW_DX[i];
+                int ny = ly + FLOW_DY[i];
+                if (nx < 0 || nx >= local_width || ny < 0 || ny >= local_height) continue;
+                
+                int cell = (ny + rect.y0) * grid.width + (nx + rect.x0);
+                if (!grid.is_walkable(cell)) continue;
+                
+                uint32_t new_dist = current + FLOW_STEP_COST_FIXED[i] * grid.costs[cell];
+                int n = ny * local_width + nx;
+                if (static_cast<float>(new_dist) < local[n]) {
+                    local[n] = static_cast<float>(new_dist);
+                    buckets[new_dist % bucket_count].push_back(n);
+                    pending++;
+                }
+            }
+        }
+    }
+    
+    for (float &dist : local) {
+        if (dist != FLT_MAX) {
+            dist /= FLOW_FIXED_SCALE;
+        }
+    }
+}
+
+static inline int local_index(const FlowGrid &grid, const CellRect &rect, int cell) {
+    return (cell / grid.width - rect.y0) * (rect.x1 - rect.x0) + (cell % grid.width - rect.x0);
+}
+
+// Holds grid.costs at terrain costs only for its lifetime; nested scopes leave it to the outermost
+class CongestionFreeCosts {
+public:
+    CongestionFreeCosts(FlowFieldManager &manager, bool active) : manager(manager) {
+        lifted = active && manager.lift_congestion_costs();
+    }
+    ~CongestionFreeCosts() {
+        if (lifted) {
+            manager.restore_congestion_costs();
+        }
+    }
+
+private:
+    FlowFieldManager &manager;
+    bool lifted = false;
+};
+
 void FlowFieldManager::_bind_methods() {
     // Methods
     ClassDB::bind_method(D_METHOD("initialize_grid"), &FlowFieldManager::initialize_grid);
     ClassDB::bind_method(D_METHOD("compute_flow_field", "target_world_pos"), &FlowFieldManager::compute_flow_field);
     ClassDB::bind_method(D_METHOD("get_flow_direction", "world_pos"), &FlowFieldManager::get_flow_direction);
+    ClassDB::bind_method(D_METHOD("request_flow_field", "target_world_pos", "start_positions", "footprint_class"), &FlowFieldManager::request_flow_field, DEFVAL(PackedVector3Array()), DEFVAL(0));
+    ClassDB::bind_method(D_METHOD("request_multi_goal_flow_field", "target_world_positions", "footprint_class"), &FlowFieldManager::request_multi_goal_flow_field, DEFVAL(0));
+    ClassDB::bind_method(D_METHOD("has_flow_field", "field_id"), &FlowFieldManager::has_flow_field);
+    ClassDB::bind_method(D_METHOD("field_covers_position", "field_id", "world_pos"), &FlowFieldManager::field_covers_position);
+    ClassDB::bind_method(D_METHOD("rebuild_portal_graph"), &FlowFieldManager::rebuild_portal_graph);
+    ClassDB::bind_method(D_METHOD("get_portal_count"), &FlowFieldManager::get_portal_count);
+    ClassDB::bind_method(D_METHOD("release_flow_field", "field_id"), &FlowFieldManager::release_flow_field);
+    ClassDB::bind_method(D_METHOD("clear_flow_field_cache"), &FlowFieldManager::clear_flow_field_cache);
+    ClassDB::bind_method(D_METHOD("get_flow_direction_for", "field_id", "world_pos"), &FlowFieldManager::get_flow_direction_for);
+    ClassDB::bind_method(D_METHOD("get_flow_lookahead_point", "field_id", "world_pos", "lookahead_distance"), &FlowFieldManager::get_flow_lookahead_point);
+    ClassDB::bind_method(D_METHOD("find_path", "from", "to", "footprint_class"), &FlowFieldManager::find_path, DEFVAL(0));
+    ClassDB::bind_method(D_METHOD("should_use_path", "unit_count"), &FlowFieldManager::should_use_path);
+    ClassDB::bind_method(D_METHOD("get_walkability_version"), &FlowFieldManager::get_walkability_version);
+    ClassDB::bind_method(D_METHOD("get_last_path_time_ms"), &FlowFieldManager::get_last_path_time_ms);
+    ClassDB::bind_method(D_METHOD("get_flow_directions", "field_id", "world_positions"), &FlowFieldManager::get_flow_directions);
+    ClassDB::bind_method(D_METHOD("get_cached_field_count"), &FlowFieldManager::get_cached_field_count);
+    ClassDB::bind_method(D_METHOD("get_cache_memory_usage"), &FlowFieldManager::get_cache_memory_usage);
+    ClassDB::bind_method(D_METHOD("get_grid_memory_usage"), &FlowFieldManager::get_grid_memory_usage);
     ClassDB::bind_method(D_METHOD("is_position_walkable", "world_pos"), &FlowFieldManager::is_position_walkable);
     ClassDB::bind_method(D_METHOD("is_field_valid"), &FlowFieldManager::is_field_valid);
     ClassDB::bind_method(D_METHOD("refresh_walkability_area", "center", "radius"), &FlowFieldManager::refresh_walkability_area);
     ClassDB::bind_method(D_METHOD("mark_building_area", "position", "size", "walkable"), &FlowFieldManager::mark_building_area);
+    ClassDB::bind_method(D_METHOD("get_building_footprint_count"), &FlowFieldManager::get_building_footprint_count);
+    ClassDB::bind_method(D_METHOD("get_clearance_at", "world_pos"), &FlowFieldManager::get_clearance_at);
+    ClassDB::bind_method(D_METHOD("get_obstacle_distance_at", "world_pos"), &FlowFieldManager::get_obstacle_distance_at);
+    ClassDB::bind_method(D_METHOD("get_obstacle_gradient_at", "world_pos"), &FlowFieldManager::get_obstacle_gradient_at);
+    ClassDB::bind_method(D_METHOD("trace_obstacle_distance", "from", "direction", "max_distance", "radius"), &FlowFieldManager::trace_obstacle_distance, DEFVAL(0.0f));
+    ClassDB::bind_method(D_METHOD("is_density_update_due"), &FlowFieldManager::is_density_update_due);
+    ClassDB::bind_method(D_METHOD("update_density", "unit_positions"), &FlowFieldManager::update_density);
+    ClassDB::bind_method(D_METHOD("get_density_at", "world_pos"), &FlowFieldManager::get_density_at);
+    ClassDB::bind_method(D_METHOD("register_static_target", "target_world_pos", "footprint_class"), &FlowFieldManager::register_static_target, DEFVAL(0));
+    ClassDB::bind_method(D_METHOD("unregister_static_target", "field_id"), &FlowFieldManager::unregister_static_target);
+    ClassDB::bind_method(D_METHOD("get_static_target_count"), &FlowFieldManager::get_static_target_count);
+    ClassDB::bind_method(D_METHOD("_run_flow_field_job", "job_id"), &FlowFieldManager::_run_flow_field_job);
+    ClassDB::bind_method(D_METHOD("wait_for_flow_field_jobs"), &FlowFieldManager::wait_for_flow_field_jobs);
+    ClassDB::bind_method(D_METHOD("get_pending_job_count"), &FlowFieldManager::get_pending_job_count);
+    ClassDB::bind_method(D_METHOD("get_last_field_latency_ms"), &FlowFieldManager::get_last_field_latency_ms);
+    ClassDB::bind_method(D_METHOD("get_average_field_latency_ms"), &FlowFieldManager::get_average_field_latency_ms);
     
     // Properties
     ClassDB::bind_method(D_METHOD("set_cell_size", "size"), &FlowFieldManager::set_cell_size);
@@ -43,12 +235,124 @@ void FlowFieldManager::_bind_methods() {
     ClassDB::bind_method(D_METHOD("set_debug_draw", "enabled"), &FlowFieldManager::set_debug_draw);
     ClassDB::bind_method(D_METHOD("get_debug_draw"), &FlowFieldManager::get_debug_draw);
     ADD_PROPERTY(PropertyInfo(Variant::BOOL, "debug_draw"), "set_debug_draw", "get_debug_draw");
+    
+    ClassDB::bind_method(D_METHOD("set_cache_budget_mb", "budget"), &FlowFieldManager::set_cache_budget_mb);
+    ClassDB::bind_method(D_METHOD("get_cache_budget_mb"), &FlowFieldManager::get_cache_budget_mb);
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "cache_budget_mb", PROPERTY_HINT_RANGE, "1.0,512.0,1.0"), "set_cache_budget_mb", "get_cache_budget_mb");
+    
+    ClassDB::bind_method(D_METHOD("set_integration_engine", "engine"), &FlowFieldManager::set_integration_engine);
+    ClassDB::bind_method(D_METHOD("get_integration_engine"), &FlowFieldManager::get_integration_engine);
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "integration_engine", PROPERTY_HINT_ENUM, "Dijkstra Heap,Dial Buckets"), "set_integration_engine", "get_integration_engine");
+    
+    ClassDB::bind_method(D_METHOD("set_use_hierarchical_search", "enabled"), &FlowFieldManager::set_use_hierarchical_search);
+    ClassDB::bind_method(D_METHOD("get_use_hierarchical_search"), &FlowFieldManager::get_use_hierarchical_search);
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "use_hierarchical_search"), "set_use_hierarchical_search", "get_use_hierarchical_search");
+    
+    ClassDB::bind_method(D_METHOD("set_sector_size", "size"), &FlowFieldManager::set_sector_size);
+    ClassDB::bind_method(D_METHOD("get_sector_size"), &FlowFieldManager::get_sector_size);
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "sector_size", PROPERTY_HINT_RANGE, "8,128,1"), "set_sector_size", "get_sector_size");
+    
+    ClassDB::bind_method(D_METHOD("set_use_threaded_computation", "enabled"), &FlowFieldManager::set_use_threaded_computation);
+    ClassDB::bind_method(D_METHOD("get_use_threaded_computation"), &FlowFieldManager::get_use_threaded_computation);
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "use_threaded_computation"), "set_use_threaded_computation", "get_use_threaded_computation");
+    
+    ClassDB::bind_method(D_METHOD("set_use_line_of_sight", "enabled"), &FlowFieldManager::set_use_line_of_sight);
+    ClassDB::bind_method(D_METHOD("get_use_line_of_sight"), &FlowFieldManager::get_use_line_of_sight);
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "use_line_of_sight"), "set_use_line_of_sight", "get_use_line_of_sight");
+    
+    ClassDB::bind_method(D_METHOD("set_use_windowed_search", "enabled"), &FlowFieldManager::set_use_windowed_search);
+    ClassDB::bind_method(D_METHOD("get_use_windowed_search"), &FlowFieldManager::get_use_windowed_search);
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "use_windowed_search"), "set_use_windowed_search", "get_use_windowed_search");
+    
+    ClassDB::bind_method(D_METHOD("set_window_padding", "padding"), &FlowFieldManager::set_window_padding);
+    ClassDB::bind_method(D_METHOD("get_window_padding"), &FlowFieldManager::get_window_padding);
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "window_padding", PROPERTY_HINT_RANGE, "2,256,1"), "set_window_padding", "get_window_padding");
+    
+    ClassDB::bind_method(D_METHOD("set_use_early_termination", "enabled"), &FlowFieldManager::set_use_early_termination);
+    ClassDB::bind_method(D_METHOD("get_use_early_termination"), &FlowFieldManager::get_use_early_termination);
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "use_early_termination"), "set_use_early_termination", "get_use_early_termination");
+    
+    ClassDB::bind_method(D_METHOD("set_termination_margin", "margin"), &FlowFieldManager::set_termination_margin);
+    ClassDB::bind_method(D_METHOD("get_termination_margin"), &FlowFieldManager::get_termination_margin);
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "termination_margin", PROPERTY_HINT_RANGE, "0.0,256.0,0.5"), "set_termination_margin", "get_termination_margin");
+    
+    ClassDB::bind_method(D_METHOD("set_max_walkable_slope", "slope"), &FlowFieldManager::set_max_walkable_slope);
+    ClassDB::bind_method(D_METHOD("get_max_walkable_slope"), &FlowFieldManager::get_max_walkable_slope);
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "max_walkable_slope", PROPERTY_HINT_RANGE, "0.0,1.0,0.01"), "set_max_walkable_slope", "get_max_walkable_slope");
+    
+    ClassDB::bind_method(D_METHOD("set_max_height_difference", "difference"), &FlowFieldManager::set_max_height_difference);
+    ClassDB::bind_method(D_METHOD("get_max_height_difference"), &FlowFieldManager::get_max_height_difference);
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "max_height_difference", PROPERTY_HINT_RANGE, "0.1,20.0,0.1"), "set_max_height_difference", "get_max_height_difference");
+    
+    ClassDB::bind_method(D_METHOD("set_slope_cost_scale", "scale"), &FlowFieldManager::set_slope_cost_scale);
+    ClassDB::bind_method(D_METHOD("get_slope_cost_scale"), &FlowFieldManager::get_slope_cost_scale);
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "slope_cost_scale", PROPERTY_HINT_RANGE, "0.0,16.0,0.1"), "set_slope_cost_scale", "get_slope_cost_scale");
+    
+    ClassDB::bind_method(D_METHOD("set_footprint_radius", "footprint_class", "radius"), &FlowFieldManager::set_footprint_radius);
+    ClassDB::bind_method(D_METHOD("get_footprint_radius", "footprint_class"), &FlowFieldManager::get_footprint_radius);
+    ADD_PROPERTYI(PropertyInfo(Variant::FLOAT, "infantry_radius", PROPERTY_HINT_RANGE, "0.1,10.0,0.1"), "set_footprint_radius", "get_footprint_radius", (int)FootprintClass::INFANTRY);
+    ADD_PROPERTYI(PropertyInfo(Variant::FLOAT, "light_vehicle_radius", PROPERTY_HINT_RANGE, "0.1,10.0,0.1"), "set_footprint_radius", "get_footprint_radius", (int)FootprintClass::LIGHT_VEHICLE);
+    ADD_PROPERTYI(PropertyInfo(Variant::FLOAT, "heavy_vehicle_radius", PROPERTY_HINT_RANGE, "0.1,10.0,0.1"), "set_footprint_radius", "get_footprint_radius", (int)FootprintClass::HEAVY_VEHICLE);
+    
+    ClassDB::bind_method(D_METHOD("set_use_density_costs", "enabled"), &FlowFieldManager::set_use_density_costs);
+    ClassDB::bind_method(D_METHOD("get_use_density_costs"), &FlowFieldManager::get_use_density_costs);
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "use_density_costs"), "set_use_density_costs", "get_use_density_costs");
+    
+    ClassDB::bind_method(D_METHOD("set_density_update_interval", "interval"), &FlowFieldManager::set_density_update_interval);
+    ClassDB::bind_method(D_METHOD("get_density_update_interval"), &FlowFieldManager::get_density_update_interval);
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "density_update_interval", PROPERTY_HINT_RANGE, "0.05,5.0,0.05"), "set_density_update_interval", "get_density_update_interval");
+    
+    ClassDB::bind_method(D_METHOD("set_density_decay", "decay"), &FlowFieldManager::set_density_decay);
+    ClassDB::bind_method(D_METHOD("get_density_decay"), &FlowFieldManager::get_density_decay);
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "density_decay", PROPERTY_HINT_RANGE, "0.0,0.95,0.05"), "set_density_decay", "get_density_decay");
+    
+    ClassDB::bind_method(D_METHOD("set_density_cost_scale", "scale"), &FlowFieldManager::set_density_cost_scale);
+    ClassDB::bind_method(D_METHOD("get_density_cost_scale"), &FlowFieldManager::get_density_cost_scale);
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "density_cost_scale", PROPERTY_HINT_RANGE, "0.0,8.0,0.05"), "set_density_cost_scale", "get_density_cost_scale");
+    
+    ClassDB::bind_method(D_METHOD("set_max_density_cost", "cost"), &FlowFieldManager::set_max_density_cost);
+    ClassDB::bind_method(D_METHOD("get_max_density_cost"), &FlowFieldManager::get_max_density_cost);
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "max_density_cost", PROPERTY_HINT_RANGE, "0,64,1"), "set_max_density_cost", "get_max_density_cost");
+    
+    ClassDB::bind_method(D_METHOD("set_congestion_repair_interval", "interval"), &FlowFieldManager::set_congestion_repair_interval);
+    ClassDB::bind_method(D_METHOD("get_congestion_repair_interval"), &FlowFieldManager::get_congestion_repair_interval);
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "congestion_repair_interval", PROPERTY_HINT_RANGE, "0.0,10.0,0.25"), "set_congestion_repair_interval", "get_congestion_repair_interval");
+    
+    
+    ClassDB::bind_method(D_METHOD("set_path_unit_threshold", "threshold"), &FlowFieldManager::set_path_unit_threshold);
+    ClassDB::bind_method(D_METHOD("get_path_unit_threshold"), &FlowFieldManager::get_path_unit_threshold);
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "path_unit_threshold", PROPERTY_HINT_RANGE, "0,64,1"), "set_path_unit_threshold", "get_path_unit_threshold");
+    
+    ClassDB::bind_method(D_METHOD("set_path_heuristic_weight", "weight"), &FlowFieldManager::set_path_heuristic_weight);
+    ClassDB::bind_method(D_METHOD("get_path_heuristic_weight"), &FlowFieldManager::get_path_heuristic_weight);
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "path_heuristic_weight", PROPERTY_HINT_RANGE, "1.0,3.0,0.05"), "set_path_heuristic_weight", "get_path_heuristic_weight");
+    
+    ClassDB::bind_method(D_METHOD("set_path_max_expansions", "expansions"), &FlowFieldManager::set_path_max_expansions);
+    ClassDB::bind_method(D_METHOD("get_path_max_expansions"), &FlowFieldManager::get_path_max_expansions);
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "path_max_expansions", PROPERTY_HINT_RANGE, "0,1048576,1024"), "set_path_max_expansions", "get_path_max_expansions");
+    
+    ClassDB::bind_method(D_METHOD("set_persist_static_fields", "enabled"), &FlowFieldManager::set_persist_static_fields);
+    ClassDB::bind_method(D_METHOD("get_persist_static_fields"), &FlowFieldManager::get_persist_static_fields);
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "persist_static_fields"), "set_persist_static_fields", "get_persist_static_fields");
+    
+    ClassDB::bind_method(D_METHOD("set_static_field_directory", "directory"), &FlowFieldManager::set_static_field_directory);
+    ClassDB::bind_method(D_METHOD("get_static_field_directory"), &FlowFieldManager::get_static_field_directory);
+    ADD_PROPERTY(PropertyInfo(Variant::STRING, "static_field_directory", PROPERTY_HINT_DIR), "set_static_field_directory", "get_static_field_directory");
+    
+    // Signals
+    ADD_SIGNAL(MethodInfo("flow_field_ready", PropertyInfo(Variant::INT, "field_id"), PropertyInfo(Variant::FLOAT, "latency_ms")));
+}
+
+size_t FlowField::memory_usage() const {
+    return integration.capacity() * sizeof(float) + directions.capacity() * sizeof(uint8_t) + sector_mask.capacity() +
+           los_bits.capacity() * sizeof(uint64_t) + start_cells.capacity() * sizeof(int);
 }
 
 FlowFieldManager::FlowFieldManager() {
 }
 
 FlowFieldManager::~FlowFieldManager() {
+    wait_for_flow_field_jobs();
 }
 
 void FlowFieldManager::_ready() {
@@ -58,18 +362,13 @@ void FlowFieldManager::_ready() {
     
     // Try to match grid to terrain size
     Node *terrain_node = get_tree()->get_root()->find_child("TerrainGenerator", true, false);
-    if (terrain_node) {
-        Variant map_size = terrain_node->get("map_size");
-        Variant tile_size = terrain_node->get("tile_size");
-        if (map_size.get_type() == Variant::INT && tile_size.get_type() == Variant::FLOAT) {
-            int terrain_size = (int)map_size;
-            float terrain_tile = (float)tile_size;
-            // Match grid to terrain dimensions
-            grid_width = terrain_size;
-            grid_height = terrain_size;
-            cell_size = terrain_tile;
-            UtilityFunctions::print("FlowFieldManager: Matched terrain - size=", terrain_size, " tile=", terrain_tile);
-        }
+    terrain_generator = Object::cast_to<TerrainGenerator>(terrain_node);
+    if (terrain_generator) {
+        // Match grid to terrain dimensions
+        grid_width = terrain_generator->get_map_size();
+        grid_height = terrain_generator->get_map_size();
+        cell_size = terrain_generator->get_tile_size();
+        UtilityFunctions::print("FlowFieldManager: Matched terrain - size=", grid_width, " tile=", cell_size);
     }
     
     // Set grid origin to center the grid (matching terrain center)
@@ -79,10 +378,8 @@ void FlowFieldManager::_ready() {
         -grid_height * cell_size / 2.0f
     );
     
+    // Terrain reference must be set first so the initial pass samples the heightmap
     initialize_grid();
-    
-    // Store terrain reference for walkability queries
-    terrain_generator = terrain_node;
 }
 
 void FlowFieldManager::_process(double delta) {
@@ -90,332 +387,2790 @@ void FlowFieldManager::_process(double delta) {
         return;
     }
     
-    if (debug_draw && field_computed) {
+    // Swap in fields finished by worker threads
+    poll_flow_field_jobs();
+    
+    density_timer += (float)delta;
+    
+    if (debug_draw && is_field_valid()) {
         draw_debug_field();
     }
 }
 
+void FlowFieldManager::_exit_tree() {
+    // Workers must not outlive the manager
+    wait_for_flow_field_jobs();
+}
+
 void FlowFieldManager::initialize_grid() {
-    grid.clear();
-    grid.resize(grid_width);
+    grid.resize(grid_width, grid_height);
+    density.assign(static_cast<size_t>(grid_width) * grid_height, 0.0f);
+    congestion_costs.assign(density.size(), 0);
+    density_cells.clear();
     
-    for (int x = 0; x < grid_width; x++) {
-        grid[x].resize(grid_height);
-        for (int y = 0; y < grid_height; y++) {
-            FlowCell &cell = grid[x][y];
-            cell.x = x;
-            cell.y = y;
-            cell.cost = 1.0f;
-            cell.distance = std::numeric_limits<float>::max();
-            cell.direction = Vector3(0, 0, 0);
-            cell.walkable = true;
-        }
-    }
+    // Cached fields and sectors were sized for the previous grid
+    clear_flow_field_cache();
+    sector_edges_ready.clear();
+    portal_graph_dirty = true;
     
     update_walkability();
+    refresh_static_fields();
 }
 
 void FlowFieldManager::update_walkability() {
-    Ref<World3D> world = get_viewport()->get_world_3d();
-    if (world.is_null()) return;
+    CellRect full;
+    full.x1 = grid_width;
+    full.y1 = grid_height;
     
-    PhysicsDirectSpaceState3D *space_state = world->get_direct_space_state();
-    if (!space_state) return;
+    sample_terrain(full);
+    apply_walkability(full, nullptr);
+    update_clearance(full, nullptr);
+    update_obstacle_distance(full);
     
-    for (int x = 0; x < grid_width; x++) {
-        for (int y = 0; y < grid_height; y++) {
-            Vector3 world_pos = grid_to_world(x, y);
-            
-            // First check: is this position on valid terrain?
-            bool on_terrain = true;
-            bool is_water = false;
-            bool is_buildable = true;
-            float terrain_height = 0.0f;
-            
-            if (terrain_generator) {
-                // Query terrain for this position
-                Variant height_result = terrain_generator->call("get_height_at", world_pos.x, world_pos.z);
-                Variant water_result = terrain_generator->call("is_water_at", world_pos.x, world_pos.z);
-                Variant buildable_result = terrain_generator->call("is_buildable_at", world_pos.x, world_pos.z);
-                
-                if (height_result.get_type() == Variant::FLOAT || height_result.get_type() == Variant::INT) {
-                    terrain_height = (float)height_result;
-                    // Check if terrain exists (very low height indicates off-map)
-                    on_terrain = terrain_height > -50.0f;
-                }
-                
-                if (water_result.get_type() == Variant::BOOL) {
-                    is_water = (bool)water_result;
-                }
-                
-                if (buildable_result.get_type() == Variant::BOOL) {
-                    is_buildable = (bool)buildable_result;
-                }
-            }
-            
-            // Terrain must be valid and not water
-            if (!on_terrain || is_water) {
-                grid[x][y].walkable = false;
-                grid[x][y].cost = 999.0f;
-                continue;
-            }
-            
-            // Second check: raycast for obstacles (buildings)
-            Vector3 from = world_pos + Vector3(0, terrain_sample_height, 0);
-            Vector3 to = world_pos - Vector3(0, terrain_sample_height, 0);
-            
-            Ref<PhysicsRayQueryParameters3D> query = PhysicsRayQueryParameters3D::create(from, to);
-            query->set_collision_mask(obstacle_collision_layer);
-            
-            Dictionary result = space_state->intersect_ray(query);
-            
-            // Cell is unwalkable if there's a building/obstacle there
-            bool has_obstacle = !result.is_empty();
-            
-            grid[x][y].walkable = !has_obstacle;
-            
-            // Set cost based on terrain type (steep areas cost more)
-            if (!is_buildable && grid[x][y].walkable) {
-                // Steeper terrain (mountains, cliffs) have higher cost
-                grid[x][y].cost = 2.0f;
-            } else {
-                grid[x][y].cost = 1.0f;
-            }
-        }
-    }
+    mark_sectors_dirty(full);
+    portal_graph_dirty = true;
+    walkability_version++;
 }
 
 void FlowFieldManager::refresh_walkability_area(const Vector3 &center, float radius) {
-    // Refresh walkability for cells within radius of the center point
+    // Re-sample terrain and footprints for cells within radius of the center point
     int cells_radius = static_cast<int>(radius / cell_size) + 1;
     Vector2i center_cell = world_to_grid(center);
     
-    Ref<World3D> world = get_viewport()->get_world_3d();
-    if (world.is_null()) return;
+    CellRect area;
+    area.x0 = center_cell.x - cells_radius;
+    area.y0 = center_cell.y - cells_radius;
+    area.x1 = center_cell.x + cells_radius + 1;
+    area.y1 = center_cell.y + cells_radius + 1;
     
-    PhysicsDirectSpaceState3D *space_state = world->get_direct_space_state();
-    if (!space_state) return;
+    std::vector<int> changed_cells;
+    sample_terrain(area);
+    apply_walkability(area, &changed_cells);
     
-    for (int dx = -cells_radius; dx <= cells_radius; dx++) {
-        for (int dy = -cells_radius; dy <= cells_radius; dy++) {
-            int x = center_cell.x + dx;
-            int y = center_cell.y + dy;
-            
-            if (!is_valid_cell(x, y)) continue;
-            
-            Vector3 world_pos = grid_to_world(x, y);
-            
-            Vector3 from = world_pos + Vector3(0, terrain_sample_height, 0);
-            Vector3 to = world_pos - Vector3(0, terrain_sample_height, 0);
-            
-            Ref<PhysicsRayQueryParameters3D> query = PhysicsRayQueryParameters3D::create(from, to);
-            query->set_collision_mask(obstacle_collision_layer);
-            
-            Dictionary result = space_state->intersect_ray(query);
-            grid[x][y].walkable = result.is_empty();
-        }
+    if (changed_cells.empty()) {
+        return;
     }
     
-    // Invalidate the current flow field so it gets recomputed
-    field_computed = false;
+    mark_sectors_dirty(area);
+    update_clearance(area, &changed_cells);
+    update_obstacle_distance(area);
+    portal_graph_dirty = true;
+    
+    // Keep live fields valid by repairing only what the change affects
+    repair_flow_fields(changed_cells);
 }
 
 void FlowFieldManager::mark_building_area(const Vector3 &position, float size, bool walkable) {
-    // Mark cells covered by a building as walkable or unwalkable
-    int cells_radius = static_cast<int>(size / cell_size / 2.0f) + 1;
-    Vector2i center_cell = world_to_grid(position);
-    
-    for (int dx = -cells_radius; dx <= cells_radius; dx++) {
-        for (int dy = -cells_radius; dy <= cells_radius; dy++) {
-            int x = center_cell.x + dx;
-            int y = center_cell.y + dy;
-            
-            if (!is_valid_cell(x, y)) continue;
-            
-            grid[x][y].walkable = walkable;
-        }
-    }
+    BuildingFootprint footprint;
+    footprint.position = position;
+    footprint.size = size;
+    CellRect area = get_footprint_rect(footprint);
     
-    // Invalidate the current flow field
-    field_computed = false;
-}
-
-void FlowFieldManager::compute_flow_field(const Vector3 &target_world_pos) {
-    Vector2i target_cell = world_to_grid(target_world_pos);
+    if (walkable) {
+        // Drop footprints on the same cells; overlapping neighbors are re-stamped below
+        Vector2i center_cell = world_to_grid(position);
+        building_footprints.erase(std::remove_if(building_footprints.begin(), building_footprints.end(),
+            [&](const BuildingFootprint &existing) {
+                return world_to_grid(existing.position) == center_cell && std::abs(existing.size - size) < cell_size;
+            }), building_footprints.end());
+    } else {
+        building_footprints.push_back(footprint);
+    }
+    rebuild_footprint_buckets();
     
-    if (!is_valid_cell(target_cell.x, target_cell.y)) {
-        UtilityFunctions::print("FlowFieldManager: Target outside grid bounds");
+    // Buildings placed before the grid exists are stamped by the first update_walkability
+    if (terrain_costs.size() != grid.costs.size() || grid.costs.empty()) {
         return;
     }
     
-    current_target = target_world_pos;
+    std::vector<int> changed_cells;
+    apply_walkability(area, &changed_cells);
     
-    // Reset distances
-    for (int x = 0; x < grid_width; x++) {
-        for (int y = 0; y < grid_height; y++) {
-            grid[x][y].distance = std::numeric_limits<float>::max();
-            grid[x][y].direction = Vector3(0, 0, 0);
-        }
+    if (changed_cells.empty()) {
+        return;
     }
     
-    compute_distances(target_cell.x, target_cell.y);
-    compute_directions();
+    mark_sectors_dirty(area);
+    update_clearance(area, &changed_cells);
+    update_obstacle_distance(area);
+    portal_graph_dirty = true;
     
-    field_computed = true;
+    // Keep live fields valid by repairing only what the change affects
+    repair_flow_fields(changed_cells);
 }
 
-void FlowFieldManager::compute_distances(int target_x, int target_y) {
-    // Priority queue: (distance, x, y)
-    auto cmp = [](const std::tuple<float, int, int> &a, const std::tuple<float, int, int> &b) {
-        return std::get<0>(a) > std::get<0>(b);
-    };
-    std::priority_queue<std::tuple<float, int, int>, std::vector<std::tuple<float, int, int>>, decltype(cmp)> open_set(cmp);
+void FlowFieldManager::sample_terrain(const CellRect &requested) {
+    const size_t cell_count = static_cast<size_t>(grid_width) * grid_height;
+    if (terrain_costs.size() != cell_count) {
+        terrain_costs.assign(cell_count, FLOW_COST_DEFAULT);
+    }
     
-    grid[target_x][target_y].distance = 0;
-    open_set.push(std::make_tuple(0.0f, target_x, target_y));
+    CellRect area = clamp_to_grid(requested);
+    if (area.x0 >= area.x1 || area.y0 >= area.y1) {
+        return;
+    }
     
-    // 8-directional neighbors (including diagonals)
-    const int dx[] = {-1, 0, 1, -1, 1, -1, 0, 1};
-    const int dy[] = {-1, -1, -1, 0, 0, 1, 1, 1};
-    const float costs[] = {1.414f, 1.0f, 1.414f, 1.0f, 1.0f, 1.414f, 1.0f, 1.414f};
+    const PackedFloat32Array *heightmap = terrain_generator ? &terrain_generator->get_heightmap() : nullptr;
     
-    while (!open_set.empty()) {
-        auto [dist, x, y] = open_set.top();
-        open_set.pop();
-        
-        // Skip if we've found a better path
-        if (dist > grid[x][y].distance) {
-            continue;
+    // No terrain to sample: open ground everywhere
+    if (!heightmap || heightmap->is_empty()) {
+        for (int y = area.y0; y < area.y1; y++) {
+            std::fill(terrain_costs.begin() + y * grid_width + area.x0, terrain_costs.begin() + y * grid_width + area.x1, FLOW_COST_DEFAULT);
         }
+        return;
+    }
+    
+    const float *heights = heightmap->ptr();
+    const int map_size = terrain_generator->get_map_size();
+    const float tile_size = terrain_generator->get_tile_size();
+    const float max_height = terrain_generator->get_max_height();
+    const float water_level = terrain_generator->get_water_level();
+    const float half_world = map_size * tile_size * 0.5f;
+    
+    // Cell-center heights over the area plus a one-cell ring for the slope stencil
+    const int hx0 = std::max(area.x0 - 1, 0);
+    const int hy0 = std::max(area.y0 - 1, 0);
+    const int hx1 = std::min(area.x1 + 1, grid_width);
+    const int hy1 = std::min(area.y1 + 1, grid_height);
+    const int stride = hx1 - hx0;
+    std::vector<float> cell_heights(static_cast<size_t>(stride) * (hy1 - hy0));
+    std::vector<uint8_t> off_map(cell_heights.size(), 0);
+    
+    for (int y = hy0; y < hy1; y++) {
+        float wz = grid_origin.z + (y + 0.5f) * cell_size;
+        float hz = (wz + half_world) / tile_size;
+        bool row_off = hz < 0.0f || hz > map_size - 1;
+        hz = Math::clamp(hz, 0.0f, (float)(map_size - 1));
+        int z0 = (int)hz;
+        int z1 = std::min(z0 + 1, map_size - 1);
+        float fz = hz - z0;
+        const float *row0 = heights + z0 * map_size;
+        const float *row1 = heights + z1 * map_size;
         
-        // Check all neighbors
-        for (int i = 0; i < 8; i++) {
-            int nx = x + dx[i];
-            int ny = y + dy[i];
-            
-            if (!is_valid_cell(nx, ny)) continue;
-            if (!grid[nx][ny].walkable) continue;
+        for (int x = hx0; x < hx1; x++) {
+            float wx = grid_origin.x + (x + 0.5f) * cell_size;
+            float hx = (wx + half_world) / tile_size;
+            size_t local = static_cast<size_t>(y - hy0) * stride + (x - hx0);
+            off_map[local] = row_off || hx < 0.0f || hx > map_size - 1;
+            hx = Math::clamp(hx, 0.0f, (float)(map_size - 1));
+            int x0 = (int)hx;
+            int x1 = std::min(x0 + 1, map_size - 1);
+            float fx = hx - x0;
             
-            float new_dist = grid[x][y].distance + costs[i] * grid[nx][ny].cost;
-            
-            if (new_dist < grid[nx][ny].distance) {
-                grid[nx][ny].distance = new_dist;
-                open_set.push(std::make_tuple(new_dist, nx, ny));
-            }
+            // Same bilinear filter as TerrainGenerator::get_height_at
+            float h0 = row0[x0] + fx * (row0[x1] - row0[x0]);
+            float h1 = row1[x0] + fx * (row1[x1] - row1[x0]);
+            cell_heights[local] = (h0 + fz * (h1 - h0)) * max_height;
         }
     }
-}
-
-void FlowFieldManager::compute_directions() {
-    const int dx[] = {-1, 0, 1, -1, 1, -1, 0, 1};
-    const int dy[] = {-1, -1, -1, 0, 0, 1, 1, 1};
     
-    for (int x = 0; x < grid_width; x++) {
-        for (int y = 0; y < grid_height; y++) {
-            if (!grid[x][y].walkable) continue;
-            if (grid[x][y].distance == std::numeric_limits<float>::max()) continue;
+    for (int y = area.y0; y < area.y1; y++) {
+        for (int x = area.x0; x < area.x1; x++) {
+            size_t local = static_cast<size_t>(y - hy0) * stride + (x - hx0);
+            float h = cell_heights[local];
+            uint8_t &cost = terrain_costs[y * grid_width + x];
             
-            float min_dist = grid[x][y].distance;
-            int best_dx = 0;
-            int best_dy = 0;
+            // Outside the terrain or under water
+            if (off_map[local] || h <= water_level) {
+                cost = FLOW_COST_IMPASSABLE;
+                continue;
+            }
             
-            for (int i = 0; i < 8; i++) {
-                int nx = x + dx[i];
-                int ny = y + dy[i];
-                
-                if (!is_valid_cell(nx, ny)) continue;
-                if (!grid[nx][ny].walkable) continue;
-                
-                if (grid[nx][ny].distance < min_dist) {
-                    min_dist = grid[nx][ny].distance;
-                    best_dx = dx[i];
-                    best_dy = dy[i];
-                }
+            // Neighbor heights, clamped at the grid edge
+            float h_left = x > 0 ? cell_heights[local - 1] : h;
+            float h_right = x + 1 < grid_width ? cell_heights[local + 1] : h;
+            float h_down = y > 0 ? cell_heights[local - stride] : h;
+            float h_up = y + 1 < grid_height ? cell_heights[local + stride] : h;
+            
+            // Cliffs: too large a step to any adjacent cell
+            float step = std::max(std::max(std::abs(h_left - h), std::abs(h_right - h)),
+                                  std::max(std::abs(h_down - h), std::abs(h_up - h)));
+            if (step > max_height_difference) {
+                cost = FLOW_COST_IMPASSABLE;
+                continue;
+            }
+            
+            // Slope from the central-difference normal (0 = flat, 1 = vertical)
+            float nx = h_left - h_right;
+            float nz = h_down - h_up;
+            float ny = 2.0f * cell_size;
+            float slope = 1.0f - ny / std::sqrt(nx * nx + ny * ny + nz * nz);
+            
+            if (slope > max_walkable_slope) {
+                cost = FLOW_COST_IMPASSABLE;
+                continue;
             }
             
-            // Convert grid direction to world direction
-            grid[x][y].direction = Vector3(best_dx * cell_size, 0, best_dy * cell_size).normalized();
+            // Graded cost: units slow down on climbs, so price the steeper of the
+            // local gradient and the largest step to a neighbor (both rise over run)
+            float gradient = std::sqrt(nx * nx + nz * nz) / ny;
+            float grade = std::max(gradient, step / cell_size);
+            float graded = 1.0f + grade * slope_cost_scale;
+            int graded_cost = std::min((int)(graded + 0.5f), (int)FLOW_COST_IMPASSABLE - 1);
+            
+            // Shoreline is walkable but slower
+            if (h <= water_level + SHORELINE_HEIGHT) {
+                graded_cost = std::max(graded_cost, (int)FLOW_COST_ROUGH);
+            }
+            cost = (uint8_t)graded_cost;
         }
     }
 }
 
-Vector3 FlowFieldManager::get_flow_direction(const Vector3 &world_pos) const {
-    if (!field_computed) {
-        return Vector3(0, 0, 0);
+void FlowFieldManager::apply_walkability(const CellRect &requested, std::vector<int> *changed_cells) {
+    CellRect area = clamp_to_grid(requested);
+    if (area.x0 >= area.x1 || area.y0 >= area.y1) {
+        return;
     }
     
-    Vector2i cell = world_to_grid(world_pos);
-    
-    if (!is_valid_cell(cell.x, cell.y)) {
-        return Vector3(0, 0, 0);
+    // Stamp every footprint overlapping the area
+    const int area_width = area.x1 - area.x0;
+    std::vector<uint8_t> blocked(static_cast<size_t>(area_width) * (area.y1 - area.y0), 0);
+    for (const BuildingFootprint &footprint : building_footprints) {
+        CellRect rect = get_footprint_rect(footprint);
+        int x0 = std::max(rect.x0, area.x0);
+        int y0 = std::max(rect.y0, area.y0);
+        int x1 = std::min(rect.x1, area.x1);
+        int y1 = std::min(rect.y1, area.y1);
+        if (x0 >= x1 || y0 >= y1) continue;
+        
+        for (int y = y0; y < y1; y++) {
+            auto row = blocked.begin() + (y - area.y0) * area_width;
+            std::fill(row + (x0 - area.x0), row + (x1 - area.x0), 1);
+        }
     }
     
-    return grid[cell.x][cell.y].direction;
-}
-
-bool FlowFieldManager::is_position_walkable(const Vector3 &world_pos) const {
-    Vector2i cell = world_to_grid(world_pos);
-    
-    if (!is_valid_cell(cell.x, cell.y)) {
-        return false;
+    for (int y = area.y0; y < area.y1; y++) {
+        for (int x = area.x0; x < area.x1; x++) {
+            int index = y * grid_width + x;
+            uint8_t cost = get_effective_cost(index);
+            bool walkable = cost != FLOW_COST_IMPASSABLE && !blocked[(y - area.y0) * area_width + (x - area.x0)];
+            
+            if (grid.is_walkable(index) == walkable && grid.costs[index] == cost) continue;
+            
+            grid.set_walkable(index, walkable);
+            grid.set_cost(index, cost);
+            if (changed_cells) {
+                changed_cells->push_back(index);
+            }
+        }
     }
-    
-    return grid[cell.x][cell.y].walkable;
 }
 
-Vector2i FlowFieldManager::world_to_grid(const Vector3 &world_pos) const {
-    int x = static_cast<int>((world_pos.x - grid_origin.x) / cell_size);
-    int y = static_cast<int>((world_pos.z - grid_origin.z) / cell_size);
-    return Vector2i(x, y);
+CellRect FlowFieldManager::get_footprint_rect(const BuildingFootprint &footprint) const {
+    // Half-size rounded up plus one cell of margin around the base
+    int cells_radius = static_cast<int>(footprint.size / cell_size / 2.0f) + 1;
+    Vector2i center_cell = world_to_grid(footprint.position);
+    
+    CellRect rect;
+    rect.x0 = center_cell.x - cells_radius;
+    rect.y0 = center_cell.y - cells_radius;
+    rect.x1 = center_cell.x + cells_radius + 1;
+    rect.y1 = center_cell.y + cells_radius + 1;
+    return rect;
 }
 
-Vector3 FlowFieldManager::grid_to_world(int x, int y) const {
-    return Vector3(
-        grid_origin.x + (x + 0.5f) * cell_size,
-        grid_origin.y,
-        grid_origin.z + (y + 0.5f) * cell_size
-    );
+CellRect FlowFieldManager::clamp_to_grid(const CellRect &rect) const {
+    CellRect clamped;
+    clamped.x0 = std::max(rect.x0, 0);
+    clamped.y0 = std::max(rect.y0, 0);
+    clamped.x1 = std::min(rect.x1, grid_width);
+    clamped.y1 = std::min(rect.y1, grid_height);
+    return clamped;
 }
 
-bool FlowFieldManager::is_valid_cell(int x, int y) const {
-    return x >= 0 && x < grid_width && y >= 0 && y < grid_height;
+int FlowFieldManager::get_building_footprint_count() const {
+    return (int)building_footprints.size();
 }
 
-void FlowFieldManager::set_grid_size(int width, int height) {
-    grid_width = width;
-    grid_height = height;
+const std::vector<BuildingFootprint> &FlowFieldManager::get_building_footprints() const {
+    return building_footprints;
 }
 
-Vector2i FlowFieldManager::get_grid_size() const {
-    return Vector2i(grid_width, grid_height);
+void FlowFieldManager::rebuild_footprint_buckets() {
+    // Buildings come and go rarely, so the index is simply rebuilt on each change
+    footprint_buckets.clear();
+    max_footprint_half_size = 0.0f;
+    for (int i = 0; i < (int)building_footprints.size(); i++) {
+        const BuildingFootprint &footprint = building_footprints[i];
+        int64_t key = footprint_bucket_key(footprint_bucket_coord(footprint.position.x), footprint_bucket_coord(footprint.position.z));
+        footprint_buckets[key].push_back(i);
+        max_footprint_half_size = std::max(max_footprint_half_size, footprint.size * 0.5f);
+    }
 }
 
-void FlowFieldManager::set_cell_size(float size) {
-    cell_size = size;
+void FlowFieldManager::update_clearance(const CellRect &requested, std::vector<int> *changed_cells) {
+    const size_t cell_count = static_cast<size_t>(grid_width) * grid_height;
+    int cap = 1;
+    for (int c = 0; c < FOOTPRINT_CLASS_COUNT; c++) {
+        cap = std::max(cap, get_required_clearance((FootprintClass)c));
+    }
+    bool full_rebuild = clearance.size() != cell_count;
+    if (full_rebuild) {
+        clearance.assign(cell_count, 0);
+        for (int c = 0; c < FOOTPRINT_CLASS_COUNT; c++) {
+            class_walkable_bits[c].assign(grid.walkable_bits.size(), 0);
+        }
+    }
+    
+    // Capped distances only depend on blocked cells within cap, so recomputing the
+    // area plus a cap-wide ring over a window twice that wide is exact
+    CellRect area = full_rebuild ? CellRect{0, 0, grid_width, grid_height} : requested;
+    area.x0 -= cap;
+    area.y0 -= cap;
+    area.x1 += cap;
+    area.y1 += cap;
+    area = clamp_to_grid(area);
+    CellRect window = clamp_to_grid(CellRect{area.x0 - cap, area.y0 - cap, area.x1 + cap, area.y1 + cap});
+    if (area.x0 >= area.x1 || area.y0 >= area.y1) {
+        return;
+    }
+    
+    // Two-pass chamfer transform with unit weights gives the chessboard distance
+    const int ww = window.x1 - window.x0;
+    const int wh = window.y1 - window.y0;
+    std::vector<uint8_t> dist(static_cast<size_t>(ww) * wh);
+    for (int y = 0; y < wh; y++) {
+        for (int x = 0; x < ww; x++) {
+            dist[y * ww + x] = grid.is_walkable((window.y0 + y) * grid_width + window.x0 + x) ? (uint8_t)cap : 0;
+        }
+    }
+    for (int y = 0; y < wh; y++) {
+        for (int x = 0; x < ww; x++) {
+            uint8_t &d = dist[y * ww + x];
+            if (d == 0) continue;
+            if (x > 0) d = std::min<uint8_t>(d, dist[y * ww + x - 1] + 1);
+            if (y > 0) {
+                const uint8_t *up = &dist[(y - 1) * ww + x];
+                d = std::min<uint8_t>(d, up[0] + 1);
+                if (x > 0) d = std::min<uint8_t>(d, up[-1] + 1);
+                if (x + 1 < ww) d = std::min<uint8_t>(d, up[1] + 1);
+            }
+        }
+    }
+    for (int y = wh - 1; y >= 0; y--) {
+        for (int x = ww - 1; x >= 0; x--) {
+            uint8_t &d = dist[y * ww + x];
+            if (d == 0) continue;
+            if (x + 1 < ww) d = std::min<uint8_t>(d, dist[y * ww + x + 1] + 1);
+            if (y + 1 < wh) {
+                const uint8_t *down = &dist[(y + 1) * ww + x];
+                d = std::min<uint8_t>(d, down[0] + 1);
+                if (x > 0) d = std::min<uint8_t>(d, down[-1] + 1);
+                if (x + 1 < ww) d = std::min<uint8_t>(d, down[1] + 1);
+            }
+        }
+    }
+    
+    // Cells already reported (walkability changes) need no second entry
+    std::vector<uint8_t> reported;
+    if (changed_cells) {
+        reported.assign(static_cast<size_t>(ww) * wh, 0);
+        for (int index : *changed_cells) {
+            int x = index % grid_width - window.x0;
+            int y = index / grid_width - window.y0;
+            if (x >= 0 && x < ww && y >= 0 && y < wh) {
+                reported[y * ww + x] = 1;
+            }
+        }
+    }
+    
+    int required[FOOTPRINT_CLASS_COUNT];
+    for (int c = 0; c < FOOTPRINT_CLASS_COUNT; c++) {
+        required[c] = get_required_clearance((FootprintClass)c);
+    }
+    
+    for (int y = area.y0; y < area.y1; y++) {
+        for (int x = area.x0; x < area.x1; x++) {
+            int index = y * grid_width + x;
+            size_t local = static_cast<size_t>(y - window.y0) * ww + (x - window.x0);
+            uint8_t value = dist[local];
+            clearance[index] = value;
+            
+            bool class_changed = false;
+            uint64_t bit = uint64_t(1) << (index & 63);
+            for (int c = 1; c < FOOTPRINT_CLASS_COUNT; c++) {
+                uint64_t &word = class_walkable_bits[c][index >> 6];
+                bool passable = value >= required[c];
+                if (((word & bit) != 0) != passable) {
+                    word ^= bit;
+                    class_changed = true;
+                }
+            }
+            
+            if (class_changed && changed_cells && !reported[local]) {
+                changed_cells->push_back(index);
+            }
+        }
+    }
 }
 
-float FlowFieldManager::get_cell_size() const {
-    return cell_size;
+int FlowFieldManager::get_required_clearance(FootprintClass footprint_class) const {
+    // A blocked cell k steps away has its near edge (k - 0.5) cells from this cell's center
+    float radius_cells = footprint_radius[(int)footprint_class] / cell_size;
+    int required = (int)std::ceil(radius_cells + 0.5f);
+    return std::max(1, std::min(required, 254));
 }
 
-void FlowFieldManager::set_grid_origin(const Vector3 &origin) {
-    grid_origin = origin;
+const std::vector<uint64_t> &FlowFieldManager::get_class_walkable_bits(FootprintClass footprint_class) const {
+    if (footprint_class == FootprintClass::INFANTRY || class_walkable_bits[(int)footprint_class].size() != grid.walkable_bits.size()) {
+        return grid.walkable_bits;
+    }
+    return class_walkable_bits[(int)footprint_class];
 }
 
-Vector3 FlowFieldManager::get_grid_origin() const {
-    return grid_origin;
+int FlowFieldManager::get_field_key(int goal_index, FootprintClass footprint_class) const {
+    return goal_index * FOOTPRINT_CLASS_COUNT + (int)footprint_class;
 }
 
-void FlowFieldManager::set_debug_draw(bool enabled) {
-    debug_draw = enabled;
+int FlowFieldManager::get_clearance_at(const Vector3 &world_pos) const {
+    Vector2i cell = world_to_grid(world_pos);
+    if (!is_valid_cell(cell.x, cell.y) || clearance.empty()) {
+        return 0;
+    }
+    return clearance[cell.y * grid_width + cell.x];
 }
 
-bool FlowFieldManager::get_debug_draw() const {
-    return debug_draw;
+void FlowFieldManager::update_obstacle_distance(const CellRect &requested) {
+    const size_t cell_count = static_cast<size_t>(grid_width) * grid_height;
+    const int cap = OBSTACLE_DISTANCE_CAP;
+    bool full_rebuild = obstacle_distance.size() != cell_count;
+    if (full_rebuild) {
+        obstacle_distance.assign(cell_count, 0.0f);
+    }
+    
+    // Same windowing as update_clearance: chamfer distances are at least the chessboard
+    // distance, so capped values only depend on cells within cap
+    CellRect area = full_rebuild ? CellRect{0, 0, grid_width, grid_height} : requested;
+    area.x0 -= cap;
+    area.y0 -= cap;
+    area.x1 += cap;
+    area.y1 += cap;
+    area = clamp_to_grid(area);
+    CellRect window = clamp_to_grid(CellRect{area.x0 - cap, area.y0 - cap, area.x1 + cap, area.y1 + cap});
+    if (area.x0 >= area.x1 || area.y0 >= area.y1) {
+        return;
+    }
+    
+    // Two-pass 1/sqrt(2) chamfer from both sides of the boundary: open cells measure to the
+    // nearest blocked cell, blocked cells to the nearest open one
+    const int ww = window.x1 - window.x0;
+    const int wh = window.y1 - window.y0;
+    const float diagonal = 1.41421356f;
+    std::vector<float> outside(static_cast<size_t>(ww) * wh);
+    std::vector<float> inside(outside.size());
+    for (int y = 0; y < wh; y++) {
+        for (int x = 0; x < ww; x++) {
+            bool walkable = grid.is_walkable((window.y0 + y) * grid_width + window.x0 + x);
+            outside[y * ww + x] = walkable ? (float)cap : 0.0f;
+            inside[y * ww + x] = walkable ? 0.0f : (float)cap;
+        }
+    }
+    for (std::vector<float> *pass : {&outside, &inside}) {
+        std::vector<float> &dist = *pass;
+        for (int y = 0; y < wh; y++) {
+            for (int x = 0; x < ww; x++) {
+                float &d = dist[y * ww + x];
+                if (d == 0.0f) continue;
+                if (x > 0) d = std::min(d, dist[y * ww + x - 1] + 1.0f);
+                if (y > 0) {
+                    const float *up = &dist[(y - 1) * ww + x];
+                    d = std::min(d, up[0] + 1.0f);
+                    if (x > 0) d = std::min(d, up[-1] + diagonal);
+                    if (x + 1 < ww) d = std::min(d, up[1] + diagonal);
+                }
+            }
+        }
+        for (int y = wh - 1; y >= 0; y--) {
+            for (int x = ww - 1; x >= 0; x--) {
+                float &d = dist[y * ww + x];
+                if (d == 0.0f) continue;
+                if (x + 1 < ww) d = std::min(d, dist[y * ww + x + 1] + 1.0f);
+                if (y + 1 < wh) {
+                    const float *down = &dist[(y + 1) * ww + x];
+                    d = std::min(d, down[0] + 1.0f);
+                    if (x > 0) d = std::min(d, down[-1] + diagonal);
+                    if (x + 1 < ww) d = std::min(d, down[1] + diagonal);
+                }
+            }
+        }
+    }
+    
+    // Centre-to-centre distances less half a cell put zero on the shared cell edge
+    for (int y = area.y0; y < area.y1; y++) {
+        for (int x = area.x0; x < area.x1; x++) {
+            size_t local = static_cast<size_t>(y - window.y0) * ww + (x - window.x0);
+            float cells = outside[local] > 0.0f ? outside[local] - 0.5f : 0.5f - inside[local];
+            obstacle_distance[y * grid_width + x] = cells * cell_size;
+        }
+    }
+}
+
+float FlowFieldManager::sample_obstacle_distance(const Vector3 &world_pos, Vector3 *gradient) const {
+    const float open_distance = OBSTACLE_DISTANCE_CAP * cell_size;
+    if (obstacle_distance.empty()) {
+        if (gradient) *gradient = Vector3(0, 0, 0);
+        return open_distance;
+    }
+    
+    // Bilinear over the four nearest cell centres, clamped at the grid edge
+    const float inv_cell = 1.0f / cell_size;
+    float u = (world_pos.x - grid_origin.x) * inv_cell - 0.5f;
+    float v = (world_pos.z - grid_origin.z) * inv_cell - 0.5f;
+    float fu = std::floor(u);
+    float fv = std::floor(v);
+    float tx = u - fu;
+    float ty = v - fv;
+    int x0 = std::min(std::max((int)fu, 0), grid_width - 1);
+    int y0 = std::min(std::max((int)fv, 0), grid_height - 1);
+    int x1 = std::min(std::max((int)fu + 1, 0), grid_width - 1);
+    int y1 = std::min(std::max((int)fv + 1, 0), grid_height - 1);
+    
+    float d00 = obstacle_distance[y0 * grid_width + x0];
+    float d10 = obstacle_distance[y0 * grid_width + x1];
+    float d01 = obstacle_distance[y1 * grid_width + x0];
+    float d11 = obstacle_distance[y1 * grid_width + x1];
+    
+    if (gradient) {
+        // Derivative of the bilinear patch; points away from the nearest obstacle
+        float gx = ((d10 - d00) * (1.0f - ty) + (d11 - d01) * ty) * inv_cell;
+        float gz = ((d01 - d00) * (1.0f - tx) + (d11 - d10) * tx) * inv_cell;
+        float length_sq = gx * gx + gz * gz;
+        *gradient = length_sq > 1e-8f ? Vector3(gx, 0, gz) / std::sqrt(length_sq) : Vector3(0, 0, 0);
+    }
+    
+    return (d00 * (1.0f - tx) + d10 * tx) * (1.0f - ty) + (d01 * (1.0f - tx) + d11 * tx) * ty;
+}
+
+float FlowFieldManager::get_obstacle_distance_at(const Vector3 &world_pos) const {
+    return sample_obstacle_distance(world_pos, nullptr);
+}
+
+Vector3 FlowFieldManager::get_obstacle_gradient_at(const Vector3 &world_pos) const {
+    Vector3 gradient;
+    sample_obstacle_distance(world_pos, &gradient);
+    return gradient;
+}
+
+float FlowFieldManager::trace_obstacle_distance(const Vector3 &from, const Vector3 &direction, float max_distance, float radius) const {
+    if (obstacle_distance.empty()) {
+        return max_distance;
+    }
+    
+    Vector3 step = Vector3(direction.x, 0, direction.z);
+    if (step.length_squared() < 1e-8f) {
+        return max_distance;
+    }
+    step = step.normalized();
+    
+    // Sphere trace: the field guarantees nothing is closer than the sampled distance, so each
+    // step advances by the clearance left over after the radius. Steps have a floor to get past
+    // grazing surfaces; a hit after one reports the last distance known to be clear.
+    const float min_step = cell_size * 0.25f;
+    float travelled = 0.0f;
+    float clear = 0.0f;
+    for (int i = 0; i < OBSTACLE_TRACE_MAX_STEPS && travelled < max_distance; i++) {
+        Vector3 gradient;
+        float clearance = sample_obstacle_distance(from + step * travelled, &gradient) - radius;
+        if (clearance > 0.0f) {
+            clear = std::min(travelled + clearance, max_distance);
+        } else if (gradient.dot(step) < 0.0f) {
+            return clear;
+        } else {
+            // Touching but heading along or away from the surface, as when starting against a wall
+            clear = std::min(travelled + min_step, max_distance);
+        }
+        travelled += std::max(clearance, min_step);
+    }
+    return clear;
+}
+
+bool FlowFieldManager::is_density_update_due() const {
+    return use_density_costs && density_timer >= density_update_interval;
+}
+
+void FlowFieldManager::update_density(const PackedVector3Array &unit_positions) {
+    density_timer = 0.0f;
+    if (density.size() != terrain_costs.size()) {
+        return;
+    }
+    
+    std::vector<int> changed_cells;
+    auto refresh_cost = [&](int index) {
+        float scaled = use_density_costs ? density[index] * density_cost_scale : 0.0f;
+        uint8_t extra = (uint8_t)std::min((int)(scaled + 0.5f), max_density_cost);
+        if (extra == congestion_costs[index]) return;
+        
+        congestion_costs[index] = extra;
+        if (terrain_costs[index] != FLOW_COST_IMPASSABLE) {
+            grid.set_cost(index, get_effective_cost(index));
+            changed_cells.push_back(index);
+        }
+    };
+    
+    // Decay, dropping cells that have emptied out
+    size_t kept = 0;
+    for (int index : density_cells) {
+        density[index] *= density_decay;
+        if (density[index] < 0.05f) {
+            density[index] = 0.0f;
+            refresh_cost(index);
+            continue;
+        }
+        density_cells[kept++] = index;
+    }
+    density_cells.resize(kept);
+    
+    for (int i = 0; i < unit_positions.size(); i++) {
+        Vector2i cell = world_to_grid(unit_positions[i]);
+        if (!is_valid_cell(cell.x, cell.y)) continue;
+        
+        int index = cell.y * grid_width + cell.x;
+        if (density[index] == 0.0f) {
+            density_cells.push_back(index);
+        }
+        density[index] += 1.0f;
+    }
+    
+    for (int index : density_cells) {
+        refresh_cost(index);
+    }
+    
+    if (changed_cells.empty()) {
+        return;
+    }
+    
+    // In-flight jobs snapshotted the old costs; they replay these on swap like walkability changes
+    if (!flow_field_jobs.empty()) {
+        walkability_change_log.insert(walkability_change_log.end(), changed_cells.begin(), changed_cells.end());
+    }
+    
+    // Live fields take the changes through the incremental repair, batched so one field is
+    // repaired at most once per congestion_repair_interval (sector edges are built on terrain
+    // costs alone, see lift_congestion_costs; they only pick corridors)
+    const uint64_t now_usec = Time::get_singleton()->get_ticks_usec();
+    const uint64_t interval_usec = static_cast<uint64_t>(congestion_repair_interval * 1000000.0f);
+    for (auto &entry : field_cache) {
+        FlowField &field = entry.second;
+        
+        // Static fields are built on terrain costs alone (see lift_congestion_costs)
+        if (field.integration.empty() || field.pending_job >= 0 || field.pin_count > 0) continue;
+        
+        for (int index : changed_cells) {
+            if (field.integration[index] != FLT_MAX) {
+                field.congestion_changes.push_back(index);
+            }
+        }
+        if (field.congestion_changes.empty() || now_usec - field.congestion_repair_usec < interval_usec) continue;
+        
+        // A cell may have changed in several splats since the last repair
+        std::sort(field.congestion_changes.begin(), field.congestion_changes.end());
+        field.congestion_changes.erase(std::unique(field.congestion_changes.begin(), field.congestion_changes.end()), field.congestion_changes.end());
+        
+        cache_memory_usage -= field.memory_usage();
+        repair_field(field, field.congestion_changes);
+        field.congestion_changes.clear();
+        field.congestion_repair_usec = now_usec;
+        cache_memory_usage += field.memory_usage();
+    }
+    
+    evict_to_budget();
+}
+
+uint8_t FlowFieldManager::get_effective_cost(int index) const {
+    uint8_t cost = terrain_costs[index];
+    if (cost == FLOW_COST_IMPASSABLE || congestion_costs.size() != terrain_costs.size()) {
+        return cost;
+    }
+    return (uint8_t)std::min((int)cost + congestion_costs[index], (int)FLOW_COST_IMPASSABLE - 1);
+}
+
+bool FlowFieldManager::lift_congestion_costs() {
+    // Static fields and sector edges must not keep a passing crowd, so they are built with the
+    // congestion layer lifted off grid.costs; every congested cell is in density_cells
+    if (congestion_lifted || congestion_costs.size() != terrain_costs.size()) {
+        return false;
+    }
+    for (int index : density_cells) {
+        if (congestion_costs[index] != 0 && terrain_costs[index] != FLOW_COST_IMPASSABLE) {
+            grid.costs[index] = terrain_costs[index];
+        }
+    }
+    congestion_lifted = true;
+    return true;
+}
+
+void FlowFieldManager::restore_congestion_costs() {
+    for (int index : density_cells) {
+        if (congestion_costs[index] != 0 && terrain_costs[index] != FLOW_COST_IMPASSABLE) {
+            grid.costs[index] = get_effective_cost(index);
+        }
+    }
+    congestion_lifted = false;
+}
+
+float FlowFieldManager::get_density_at(const Vector3 &world_pos) const {
+    Vector2i cell = world_to_grid(world_pos);
+    if (!is_valid_cell(cell.x, cell.y) || density.empty()) {
+        return 0.0f;
+    }
+    return density[cell.y * grid_width + cell.x];
+}
+
+int FlowFieldManager::register_static_target(const Vector3 &target_world_pos, int footprint_class) {
+    Vector2i target_cell = world_to_grid(target_world_pos);
+    if (!is_valid_cell(target_cell.x, target_cell.y)) {
+        return -1;
+    }
+    
+    FootprintClass size_class = (FootprintClass)Math::clamp(footprint_class, 0, FOOTPRINT_CLASS_COUNT - 1);
+    int goal_index = target_cell.y * grid_width + target_cell.x;
+    int goal_key = get_field_key(goal_index, size_class);
+    
+    FlowField *field = nullptr;
+    auto cached = field_by_goal.find(goal_key);
+    if (cached != field_by_goal.end()) {
+        field = &field_cache[cached->second];
+        if (field->pin_count > 0) {
+            field->pin_count++;
+            return field->id;
+        }
+        cache_memory_usage -= field->memory_usage();
+    } else {
+        int field_id = next_field_id++;
+        field = &field_cache[field_id];
+        field->id = field_id;
+        field->goal_cell = target_cell;
+        field->goal_indices.assign(1, goal_index);
+        field->target = target_world_pos;
+        field->footprint_class = size_class;
+        
+        lru_order.push_front(field_id);
+        field->lru_position = lru_order.begin();
+        field_by_goal[goal_key] = field_id;
+    }
+    
+    // Pinned fields cover the whole grid, so drop any window, corridor or start set
+    field->pin_count = 1;
+    field->window = CellRect();
+    field->sector_mask.clear();
+    field->start_cells.clear();
+    static_field_ids.push_back(field->id);
+    
+    // Built like any other field, on a worker when threading is on; saved once the buffer lands
+    if (!persist_static_fields || !load_static_field(*field)) {
+        build_field(*field);
+        if (persist_static_fields && field->pending_job < 0) {
+            save_static_field(*field);
+        }
+    }
+    cache_memory_usage += field->memory_usage();
+    
+    return field->id;
+}
+
+void FlowFieldManager::unregister_static_target(int field_id) {
+    auto it = field_cache.find(field_id);
+    if (it == field_cache.end() || it->second.pin_count == 0) {
+        return;
+    }
+    
+    FlowField &field = it->second;
+    if (--field.pin_count > 0) {
+        return;
+    }
+    
+    // Back to an ordinary cached field, which is repaired eagerly and now takes the congestion
+    // it was built without
+    static_field_ids.erase(std::remove(static_field_ids.begin(), static_field_ids.end(), field_id), static_field_ids.end());
+    if (field.pending_job >= 0) {
+        build_field(field);
+    } else if (!field.needs_rebuild && !field.integration.empty()) {
+        for (int index : density_cells) {
+            if (congestion_costs[index] != 0) {
+                field.deferred_changes.push_back(index);
+            }
+        }
+    }
+    refresh_static_field(field);
+    evict_to_budget();
+}
+
+int FlowFieldManager::get_static_target_count() const {
+    return static_cast<int>(static_field_ids.size());
+}
+
+int FlowFieldManager::find_static_field(int goal_index, FootprintClass footprint_class) const {
+    // Only an order on the static goal's own cell may reuse it: the field steers onto that cell,
+    // so a nearby order would never reach its own point
+    auto cached = field_by_goal.find(get_field_key(goal_index, footprint_class));
+    if (cached == field_by_goal.end()) {
+        return -1;
+    }
+    const FlowField &field = field_cache.at(cached->second);
+    return field.pin_count > 0 ? field.id : -1;
+}
+
+void FlowFieldManager::refresh_static_field(FlowField &field) {
+    if (!field.needs_rebuild && field.deferred_changes.empty()) {
+        return;
+    }
+    
+    cache_memory_usage -= field.memory_usage();
+    if (field.needs_rebuild) {
+        integrate_field(field);
+    } else {
+        repair_field(field, field.deferred_changes);
+    }
+    field.deferred_changes.clear();
+    field.needs_rebuild = false;
+    cache_memory_usage += field.memory_usage();
+}
+
+size_t FlowFieldManager::get_pinned_memory_usage() const {
+    size_t total = 0;
+    for (int field_id : static_field_ids) {
+        total += field_cache.at(field_id).memory_usage();
+    }
+    return total;
+}
+
+uint64_t FlowFieldManager::compute_walkability_hash(FootprintClass footprint_class) const {
+    // FNV-1a over everything a static field depends on except the congestion layer
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](const uint8_t *bytes, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+    };
+    
+    const std::vector<uint64_t> &walkable = get_class_walkable_bits(footprint_class);
+    mix(reinterpret_cast<const uint8_t *>(walkable.data()), walkable.size() * sizeof(uint64_t));
+    mix(terrain_costs.data(), terrain_costs.size());
+    return hash;
+}
+
+String FlowFieldManager::get_static_field_path(const FlowField &field) const {
+    // Fields only match the map they were built on, so files are keyed by the terrain seed
+    int seed = terrain_generator ? terrain_generator->get_seed() : 0;
+    int goal_index = field.goal_cell.y * grid_width + field.goal_cell.x;
+    String file_name = String::num_int64(seed) + "_" + String::num_int64(goal_index) + "_" + String::num_int64((int)field.footprint_class) + ".flow";
+    return static_field_directory.path_join(file_name);
+}
+
+bool FlowFieldManager::save_static_field(const FlowField &field) const {
+    DirAccess::make_dir_recursive_absolute(static_field_directory);
+    Ref<FileAccess> file = FileAccess::open(get_static_field_path(field), FileAccess::WRITE);
+    if (file.is_null()) {
+        UtilityFunctions::push_warning("FlowFieldManager: Could not write static field ", get_static_field_path(field));
+        return false;
+    }
+    
+    file->store_32(STATIC_FIELD_MAGIC);
+    file->store_32(STATIC_FIELD_VERSION);
+    file->store_32(grid_width);
+    file->store_32(grid_height);
+    file->store_float(cell_size);
+    file->store_32((uint32_t)field.engine);
+    file->store_64(compute_walkability_hash(field.footprint_class));
+    store_array(file, field.integration);
+    store_array(file, field.directions);
+    store_array(file, field.los_bits);
+    file->close();
+    return true;
+}
+
+bool FlowFieldManager::load_static_field(FlowField &field) const {
+    String path = get_static_field_path(field);
+    if (!FileAccess::file_exists(path)) {
+        return false;
+    }
+    
+    Ref<FileAccess> file = FileAccess::open(path, FileAccess::READ);
+    if (file.is_null()) {
+        return false;
+    }
+    
+    // Anything built for another grid, engine or walkability is stale
+    if (file->get_32() != STATIC_FIELD_MAGIC || file->get_32() != STATIC_FIELD_VERSION ||
+            (int)file->get_32() != grid_width || (int)file->get_32() != grid_height ||
+            file->get_float() != cell_size || (IntegrationEngine)file->get_32() != integration_engine ||
+            file->get_64() != compute_walkability_hash(field.footprint_class)) {
+        return false;
+    }
+    
+    const size_t cell_count = static_cast<size_t>(grid_width) * grid_height;
+    const size_t los_words = use_line_of_sight ? (cell_count + 63) / 64 : 0;
+    if (!load_array(file, field.integration, cell_count) || !load_array(file, field.directions, cell_count) ||
+            !load_array(file, field.los_bits, los_words)) {
+        field.integration.clear();
+        field.directions.clear();
+        field.los_bits.clear();
+        return false;
+    }
+    
+    field.engine = integration_engine;
+    field.settle_limit = FLT_MAX;
+    field.pending_job = -1;
+    return true;
+}
+
+void FlowFieldManager::compute_flow_field(const Vector3 &target_world_pos) {
+    Vector2i target_cell = world_to_grid(target_world_pos);
+    
+    if (!is_valid_cell(target_cell.x, target_cell.y)) {
+        UtilityFunctions::print("FlowFieldManager: Target outside grid bounds");
+        return;
+    }
+    
+    current_target = target_world_pos;
+    current_field_id = request_flow_field(target_world_pos);
+}
+
+int FlowFieldManager::request_flow_field(const Vector3 &target_world_pos, const PackedVector3Array &start_positions, int footprint_class) {
+    Vector2i target_cell = world_to_grid(target_world_pos);
+    
+    if (!is_valid_cell(target_cell.x, target_cell.y)) {
+        return -1;
+    }
+    
+    FootprintClass size_class = (FootprintClass)Math::clamp(footprint_class, 0, FOOTPRINT_CLASS_COUNT - 1);
+    int goal_index = target_cell.y * grid_width + target_cell.x;
+    int goal_key = get_field_key(goal_index, size_class);
+    
+    // Without start positions the whole grid is integrated
+    std::vector<int> start_cells;
+    for (int i = 0; i < start_positions.size(); i++) {
+        Vector2i cell = world_to_grid(start_positions[i]);
+        if (is_valid_cell(cell.x, cell.y)) {
+            start_cells.push_back(cell.y * grid_width + cell.x);
+        }
+    }
+    // The portal graph only knows infantry walkability, so wider classes integrate the whole grid
+    bool hierarchical = use_hierarchical_search && !start_cells.empty() && size_class == FootprintClass::INFANTRY;
+    bool windowed = use_windowed_search && !start_cells.empty();
+    
+    // Orders on a static target reuse its pinned field
+    int static_id = find_static_field(goal_index, size_class);
+    if (static_id >= 0) {
+        FlowField &field = field_cache[static_id];
+        touch_field(field);
+        refresh_static_field(field);
+        return static_id;
+    }
+    
+    // Serve repeated orders to the same goal cell and class from the cache
+    auto cached = field_by_goal.find(goal_key);
+    if (cached != field_by_goal.end()) {
+        FlowField &field = field_cache[cached->second];
+        touch_field(field);
+        
+        // A buffer is already being built; late starts are picked up after it lands
+        if (field.pending_job >= 0) {
+            return field.id;
+        }
+        
+        // Starts outside the corridor or window, or past an early termination, need a rebuild that reaches them
+        bool outside_corridor = false;
+        bool missing_starts = false;
+        for (int cell : start_cells) {
+            bool off_corridor = hierarchical && !field.sector_mask.empty() && !field.sector_mask[get_sector_of_cell(cell)];
+            bool off_window = !field.window.is_empty() && !field.window.contains(cell % grid_width, cell / grid_width);
+            if (off_corridor || off_window || field_stopped_short_of(field, cell)) {
+                field.start_cells.push_back(cell);
+                outside_corridor = outside_corridor || off_corridor;
+                missing_starts = true;
+            }
+        }
+        
+        if (!missing_starts) {
+            return field.id;
+        }
+        
+        // Widen the corridor and window to include the new starts; units keep the old buffer meanwhile
+        cache_memory_usage -= field.memory_usage();
+        if (outside_corridor && !find_corridor_sectors(goal_index, start_cells, field.sector_mask)) {
+            field.sector_mask.clear();
+        }
+        if (!field.window.is_empty()) {
+            fit_field_window(field);
+        }
+        build_field(field);
+        cache_memory_usage += field.memory_usage();
+        
+        evict_to_budget();
+        return field.id;
+    }
+    
+    int field_id = next_field_id++;
+    FlowField &field = field_cache[field_id];
+    field.id = field_id;
+    field.goal_cell = target_cell;
+    field.goal_indices.assign(1, goal_index);
+    field.target = target_world_pos;
+    field.footprint_class = size_class;
+    
+    if (hierarchical) {
+        if (!find_corridor_sectors(goal_index, start_cells, field.sector_mask)) {
+            // No start reaches the goal through the portal graph; fall back to the full grid
+            field.sector_mask.clear();
+        }
+    }
+    
+    // Short orders only integrate a padded box around the units and the goal
+    field.start_cells = start_cells;
+    if (windowed) {
+        field.window_padding = window_padding;
+        fit_field_window(field);
+    }
+    
+    lru_order.push_front(field_id);
+    field.lru_position = lru_order.begin();
+    field_by_goal[goal_key] = field_id;
+    
+    // Units steer straight at the target until the first buffer is ready
+    build_field(field);
+    cache_memory_usage += field.memory_usage();
+    
+    evict_to_budget();
+    
+    return field_id;
+}
+
+int FlowFieldManager::request_multi_goal_flow_field(const PackedVector3Array &target_world_positions, int footprint_class) {
+    // Goal cells are deduplicated and sorted so the same set always hits the same field
+    std::vector<int> goal_indices;
+    int first_valid = -1;
+    for (int i = 0; i < target_world_positions.size(); i++) {
+        Vector2i cell = world_to_grid(target_world_positions[i]);
+        if (is_valid_cell(cell.x, cell.y)) {
+            goal_indices.push_back(cell.y * grid_width + cell.x);
+            if (first_valid < 0) {
+                first_valid = i;
+            }
+        }
+    }
+    std::sort(goal_indices.begin(), goal_indices.end());
+    goal_indices.erase(std::unique(goal_indices.begin(), goal_indices.end()), goal_indices.end());
+    
+    if (goal_indices.empty()) {
+        return -1;
+    }
+    if (goal_indices.size() == 1) {
+        return request_flow_field(target_world_positions[first_valid], PackedVector3Array(), footprint_class);
+    }
+    
+    FootprintClass size_class = (FootprintClass)Math::clamp(footprint_class, 0, FOOTPRINT_CLASS_COUNT - 1);
+    std::vector<int> key = goal_indices;
+    key.push_back((int)size_class);
+    
+    auto cached = field_by_goal_set.find(key);
+    if (cached != field_by_goal_set.end()) {
+        FlowField &field = field_cache[cached->second];
+        touch_field(field);
+        return field.id;
+    }
+    
+    // One pass seeded from every goal; the corridor search is single-goal, so the whole grid is integrated
+    int field_id = next_field_id++;
+    FlowField &field = field_cache[field_id];
+    field.id = field_id;
+    field.goal_cell = world_to_grid(target_world_positions[first_valid]);
+    field.goal_indices = goal_indices;
+    field.target = target_world_positions[first_valid];
+    field.footprint_class = size_class;
+    
+    lru_order.push_front(field_id);
+    field.lru_position = lru_order.begin();
+    field_by_goal_set[key] = field_id;
+    
+    build_field(field);
+    cache_memory_usage += field.memory_usage();
+    
+    evict_to_budget();
+    
+    return field_id;
+}
+
+void FlowFieldManager::build_field(FlowField &field) {
+    // Integration reads the current costs, so batched congestion changes are folded in
+    field.congestion_changes.clear();
+    
+    if (use_threaded_computation && WorkerThreadPool::get_singleton()) {
+        submit_flow_field_job(field);
+        return;
+    }
+    
+    uint64_t start = Time::get_singleton()->get_ticks_usec();
+    integrate_field(field);
+    
+    float latency_ms = (Time::get_singleton()->get_ticks_usec() - start) / 1000.0f;
+    record_field_latency(latency_ms);
+    emit_signal("flow_field_ready", field.id, latency_ms);
+}
+
+void FlowFieldManager::integrate_field(FlowField &field) {
+    CongestionFreeCosts static_costs(*this, field.pin_count > 0);
+    const int cell_count = grid_width * grid_height;
+    field.integration.assign(cell_count, FLT_MAX);
+    field.directions.assign(cell_count, FLOW_DIR_NONE);
+    field.engine = integration_engine;
+    field.pending_job = -1;     // Supersedes any in-flight rebuild
+    
+    std::vector<CellRect> regions;
+    std::vector<uint64_t> corridor_bits;
+    const std::vector<uint64_t> *passable = nullptr;
+    
+    // Stop a margin past the farthest requesting unit instead of running to the map edges
+    std::vector<int> no_stops;
+    const std::vector<int> &stop_cells = use_early_termination ? field.start_cells : no_stops;
+    
+    for (;;) {
+        regions.clear();
+        passable = &get_field_passable(field, corridor_bits, &regions);
+        
+        if (integration_engine == IntegrationEngine::DIAL_BUCKETS) {
+            field.settle_limit = integrate_dial(grid, *passable, field.integration, field.goal_indices, stop_cells, termination_margin);
+        } else {
+            field.settle_limit = integrate_heap(grid, *passable, field.integration, field.goal_indices, stop_cells, termination_margin);
+        }
+        
+        // A start cut off inside the window may still be reachable around its edge
+        if (field_reaches_starts(field) || !grow_field_window(field)) {
+            break;
+        }
+        std::fill(field.integration.begin(), field.integration.end(), FLT_MAX);
+    }
+    
+    // Sight lines are only defined toward a single goal
+    if (use_line_of_sight && field.goal_indices.size() == 1) {
+        compute_line_of_sight(grid, *passable, field.goal_indices[0], field.los_bits);
+    } else {
+        field.los_bits.clear();
+    }
+    
+    build_directions(grid, *passable, field.integration, field.directions, regions);
+}
+
+const std::vector<uint64_t> &FlowFieldManager::get_field_passable(const FlowField &field, std::vector<uint64_t> &scratch, std::vector<CellRect> *regions) const {
+    const std::vector<uint64_t> &walkable = get_class_walkable_bits(field.footprint_class);
+    const bool windowed = !field.window.is_empty();
+    
+    if (field.sector_mask.empty() && !windowed) {
+        if (regions) {
+            CellRect full;
+            full.x1 = grid_width;
+            full.y1 = grid_height;
+            regions->push_back(full);
+        }
+        if (&walkable == &grid.walkable_bits) {
+            return walkable;
+        }
+        
+        scratch = walkable;
+        open_goal_reach(field, scratch);
+        return scratch;
+    }
+    
+    // Only cells inside corridor sectors and the search window are passable for this field
+    scratch.assign(walkable.size(), 0);
+    auto copy_rect = [&](CellRect rect) {
+        if (windowed) {
+            rect.x0 = std::max(rect.x0, field.window.x0);
+            rect.y0 = std::max(rect.y0, field.window.y0);
+            rect.x1 = std::min(rect.x1, field.window.x1);
+            rect.y1 = std::min(rect.y1, field.window.y1);
+            if (rect.is_empty()) return;
+        }
+        if (regions) {
+            regions->push_back(rect);
+        }
+        
+        for (int y = rect.y0; y < rect.y1; y++) {
+            for (int x = rect.x0; x < rect.x1; x++) {
+                int index = y * grid_width + x;
+                if (is_bit_set(walkable, index)) {
+                    scratch[index >> 6] |= uint64_t(1) << (index & 63);
+                }
+            }
+        }
+    };
+    
+    if (field.sector_mask.empty()) {
+        copy_rect(field.window);
+    } else {
+        for (int sector = 0; sector < (int)field.sector_mask.size(); sector++) {
+            if (field.sector_mask[sector]) {
+                copy_rect(get_sector_rect(sector));
+            }
+        }
+    }
+    
+    if (&walkable != &grid.walkable_bits) {
+        open_goal_reach(field, scratch);
+    }
+    return scratch;
+}
+
+void FlowFieldManager::open_goal_reach(const FlowField &field, std::vector<uint64_t> &passable) const {
+    // Wide units may still close in on a goal next to an obstacle
+    CellRect bounds = field.window.is_empty() ? CellRect{0, 0, grid_width, grid_height} : field.window;
+    int reach = get_required_clearance(field.footprint_class) - 1;
+    for (int goal : field.goal_indices) {
+        int gx = goal % grid_width;
+        int gy = goal / grid_width;
+        for (int y = std::max(gy - reach, bounds.y0); y < std::min(gy + reach + 1, bounds.y1); y++) {
+            for (int x = std::max(gx - reach, bounds.x0); x < std::min(gx + reach + 1, bounds.x1); x++) {
+                int index = y * grid_width + x;
+                if (grid.is_walkable(index)) {
+                    passable[index >> 6] |= uint64_t(1) << (index & 63);
+                }
+            }
+        }
+    }
+}
+
+void FlowFieldManager::fit_field_window(FlowField &field) const {
+    int min_x = grid_width;
+    int min_y = grid_height;
+    int max_x = -1;
+    int max_y = -1;
+    auto include = [&](int cell) {
+        min_x = std::min(min_x, cell % grid_width);
+        max_x = std::max(max_x, cell % grid_width);
+        min_y = std::min(min_y, cell / grid_width);
+        max_y = std::max(max_y, cell / grid_width);
+    };
+    for (int cell : field.goal_indices) include(cell);
+    for (int cell : field.start_cells) include(cell);
+    
+    int pad = field.window_padding;
+    CellRect window = clamp_to_grid(CellRect{min_x - pad, min_y - pad, max_x + pad + 1, max_y + pad + 1});
+    
+    // Past half the map the bookkeeping outweighs the cells saved
+    int64_t window_area = int64_t(window.x1 - window.x0) * (window.y1 - window.y0);
+    if (window_area * 2 >= int64_t(grid_width) * grid_height) {
+        window = CellRect();
+    }
+    field.window = window;
+}
+
+bool FlowFieldManager::grow_field_window(FlowField &field) const {
+    if (field.window.is_empty()) {
+        return false;
+    }
+    field.window_padding *= 2;
+    fit_field_window(field);
+    return true;
+}
+
+bool FlowFieldManager::field_reaches_starts(const FlowField &field) const {
+    if (field.integration.empty()) {
+        return true;
+    }
+    
+    // Starts on cells this class cannot stand on never get a value, wherever the window is
+    const std::vector<uint64_t> &walkable = get_class_walkable_bits(field.footprint_class);
+    for (int cell : field.start_cells) {
+        if (is_bit_set(walkable, cell) && field.integration[cell] == FLT_MAX) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FlowFieldManager::field_stopped_short_of(const FlowField &field, int cell) const {
+    // Unreachable cells are only told apart from unsettled ones when the search ran to completion
+    if (field.settle_limit == FLT_MAX || field.integration.empty() || field.integration[cell] != FLT_MAX) {
+        return false;
+    }
+    return is_bit_set(get_class_walkable_bits(field.footprint_class), cell);
+}
+
+void FlowFieldManager::submit_flow_field_job(FlowField &field) {
+    std::unique_ptr<FlowFieldJob> job(new FlowFieldJob());
+    job->field_id = field.id;
+    job->requested_usec = Time::get_singleton()->get_ticks_usec();
+    job->change_log_offset = walkability_change_log.size();
+    
+    // Snapshot everything the worker reads
+    job->grid.width = grid.width;
+    job->grid.height = grid.height;
+    job->grid.max_cost = grid.max_cost;
+    {
+        CongestionFreeCosts static_costs(*this, field.pin_count > 0);
+        job->grid.costs = grid.costs;
+    }
+    job->passable = get_field_passable(field, job->passable, &job->regions);
+    
+    job->result.id = field.id;
+    job->result.goal_cell = field.goal_cell;
+    job->result.goal_indices = field.goal_indices;
+    job->result.target = field.target;
+    job->result.sector_mask = field.sector_mask;
+    job->result.window = field.window;
+    if (use_early_termination) {
+        job->result.start_cells = field.start_cells;
+        job->termination_margin = termination_margin;
+    }
+    job->result.engine = integration_engine;
+    job->line_of_sight = use_line_of_sight && field.goal_indices.size() == 1;
+    
+    int job_id = next_job_id++;
+    field.pending_job = job_id;
+    
+    FlowFieldJob *job_ptr = job.get();
+    {
+        std::lock_guard<std::mutex> lock(job_mutex);
+        flow_field_jobs[job_id] = std::move(job);
+    }
+    job_ptr->task_id = WorkerThreadPool::get_singleton()->add_task(Callable(this, "_run_flow_field_job").bind(job_id), false, "FlowField integration");
+}
+
+void FlowFieldManager::_run_flow_field_job(int job_id) {
+    FlowFieldJob *job = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(job_mutex);
+        auto it = flow_field_jobs.find(job_id);
+        if (it == flow_field_jobs.end()) {
+            return;
+        }
+        job = it->second.get();
+    }
+    
+    // Runs on a worker thread: only the job's snapshot is touched
+    const int cell_count = job->grid.width * job->grid.height;
+    FlowField &result = job->result;
+    result.integration.assign(cell_count, FLT_MAX);
+    result.directions.assign(cell_count, FLOW_DIR_NONE);
+    
+    if (job->line_of_sight) {
+        compute_line_of_sight(job->grid, job->passable, result.goal_indices[0], result.los_bits);
+    }
+    
+    if (result.engine == IntegrationEngine::DIAL_BUCKETS) {
+        result.settle_limit = integrate_dial(job->grid, job->passable, result.integration, result.goal_indices, result.start_cells, job->termination_margin);
+    } else {
+        result.settle_limit = integrate_heap(job->grid, job->passable, result.integration, result.goal_indices, result.start_cells, job->termination_margin);
+    }
+    
+    build_directions(job->grid, job->passable, result.integration, result.directions, job->regions);
+}
+
+void FlowFieldManager::poll_flow_field_jobs() {
+    if (flow_field_jobs.empty()) {
+        return;
+    }
+    
+    WorkerThreadPool *pool = WorkerThreadPool::get_singleton();
+    Time *time = Time::get_singleton();
+    std::vector<std::pair<int, float>> ready_fields;
+    std::vector<int> regrow_fields;
+    
+    std::unique_lock<std::mutex> lock(job_mutex);
+    for (auto it = flow_field_jobs.begin(); it != flow_field_jobs.end();) {
+        FlowFieldJob &job = *it->second;
+        
+        // task_id is -1 once wait_for_flow_field_jobs() has already joined the task
+        if (job.task_id >= 0) {
+            if (!pool->is_task_completed(job.task_id)) {
+                ++it;
+                continue;
+            }
+            pool->wait_for_task_completion(job.task_id);
+        }
+        
+        // Fields evicted, cleared or resubmitted in the meantime drop the result
+        auto field_it = field_cache.find(job.field_id);
+        if (field_it != field_cache.end() && field_it->second.pending_job == it->first) {
+            FlowField &field = field_it->second;
+            cache_memory_usage -= field.memory_usage();
+            
+            // Swap buffers; readers only run on the main thread, so this is atomic for them
+            field.integration.swap(job.result.integration);
+            field.directions.swap(job.result.directions);
+            field.sector_mask.swap(job.result.sector_mask);
+            field.los_bits.swap(job.result.los_bits);
+            field.window = job.result.window;
+            field.settle_limit = job.result.settle_limit;
+            field.engine = job.result.engine;
+            field.pending_job = -1;
+            
+            // Replay walkability changes that landed while the job was running
+            if (job.change_log_offset < walkability_change_log.size()) {
+                std::vector<int> late_changes(walkability_change_log.begin() + job.change_log_offset, walkability_change_log.end());
+                repair_field(field, late_changes);
+            }
+            
+            // The worker cannot grow its own snapshot; a cut-off start gets a wider rebuild
+            if (field.pending_job < 0 && !field_reaches_starts(field) && grow_field_window(field)) {
+                regrow_fields.push_back(field.id);
+            }
+            
+            // Static fields built on a worker are written out once they are current
+            if (field.pin_count > 0 && field.pending_job < 0 && persist_static_fields) {
+                save_static_field(field);
+            }
+            
+            cache_memory_usage += field.memory_usage();
+            
+            float latency_ms = (time->get_ticks_usec() - job.requested_usec) / 1000.0f;
+            record_field_latency(latency_ms);
+            ready_fields.push_back(std::make_pair(field.id, latency_ms));
+        }
+        
+        it = flow_field_jobs.erase(it);
+    }
+    
+    if (flow_field_jobs.empty()) {
+        walkability_change_log.clear();
+    }
+    lock.unlock();
+    
+    // Units keep the narrow buffer until the wider one lands
+    for (int field_id : regrow_fields) {
+        submit_flow_field_job(field_cache[field_id]);
+    }
+    
+    evict_to_budget();
+    
+    for (const std::pair<int, float> &ready : ready_fields) {
+        if (has_flow_field(ready.first)) {
+            emit_signal("flow_field_ready", ready.first, ready.second);
+        }
+    }
+}
+
+void FlowFieldManager::wait_for_flow_field_jobs() {
+    WorkerThreadPool *pool = WorkerThreadPool::get_singleton();
+    if (!pool) {
+        return;
+    }
+    
+    std::vector<int64_t> tasks;
+    {
+        std::lock_guard<std::mutex> lock(job_mutex);
+        for (auto &entry : flow_field_jobs) {
+            if (entry.second->task_id >= 0) {
+                tasks.push_back(entry.second->task_id);
+            }
+        }
+    }
+    
+    for (int64_t task_id : tasks) {
+        pool->wait_for_task_completion(task_id);
+    }
+    
+    // Results are still swapped in by the next poll
+    for (auto &entry : flow_field_jobs) {
+        entry.second->task_id = -1;
+    }
+}
+
+void FlowFieldManager::record_field_latency(float latency_ms) {
+    last_field_latency_ms = latency_ms;
+    
+    // Exponential moving average so the metric tracks recent orders
+    if (average_field_latency_ms <= 0.0f) {
+        average_field_latency_ms = latency_ms;
+    } else {
+        average_field_latency_ms = average_field_latency_ms * 0.9f + latency_ms * 0.1f;
+    }
+}
+
+int FlowFieldManager::get_pending_job_count() const {
+    return static_cast<int>(flow_field_jobs.size());
+}
+
+float FlowFieldManager::get_last_field_latency_ms() const {
+    return last_field_latency_ms;
+}
+
+float FlowFieldManager::get_average_field_latency_ms() const {
+    return average_field_latency_ms;
+}
+
+void FlowFieldManager::repair_flow_fields(const std::vector<int> &changed_cells) {
+    if (changed_cells.empty()) {
+        return;
+    }
+    walkability_version++;
+    
+    // In-flight jobs integrated the old walkability; they replay this on swap
+    if (!flow_field_jobs.empty()) {
+        walkability_change_log.insert(walkability_change_log.end(), changed_cells.begin(), changed_cells.end());
+    }
+    
+    for (auto &entry : field_cache) {
+        FlowField &field = entry.second;
+        
+        // Nothing to repair until the first buffer lands
+        if (field.integration.empty()) continue;
+        
+        // Pinned fields are repaired on their next use
+        if (field.pin_count > 0) {
+            if (!field.needs_rebuild) {
+                field.deferred_changes.insert(field.deferred_changes.end(), changed_cells.begin(), changed_cells.end());
+                if (field.deferred_changes.size() > field.integration.size() / STATIC_FIELD_REBUILD_DIVISOR) {
+                    field.needs_rebuild = true;
+                    std::vector<int>().swap(field.deferred_changes);
+                }
+            }
+            continue;
+        }
+        
+        cache_memory_usage -= field.memory_usage();
+        repair_field(field, changed_cells);
+        cache_memory_usage += field.memory_usage();
+    }
+    
+    evict_to_budget();
+}
+
+void FlowFieldManager::repair_field(FlowField &field, const std::vector<int> &changed_cells) {
+    // LPA*-style repair: cells that lost every neighbor supporting their value are reset
+    // and re-settled from the consistent boundary, newly opened cells are lowered from
+    // their neighbors, and a single Dijkstra pass propagates both changes outward.
+    const int width = grid_width;
+    const int height = grid_height;
+    const int goal_index = field.goal_cell.y * width + field.goal_cell.x;
+    const float *step_cost = field.engine == IntegrationEngine::DIAL_BUCKETS ? FLOW_STEP_COST_QUANTIZED : FLOW_STEP_COST;
+    std::vector<float> &integration = field.integration;
+    CongestionFreeCosts static_costs(*this, field.pin_count > 0);
+    
+    std::vector<uint64_t> corridor_bits;
+    const std::vector<uint64_t> &passable = get_field_passable(field, corridor_bits, nullptr);
+    
+    auto for_each_neighbor = [&](int index, auto &&visit) {
+        int x = index % width;
+        int y = index / width;
+        for (int i = 0; i < FLOW_DIR_COUNT; i++) {
+            int nx = x + FLOW_DX[i];
+            int ny = y + FLOW_DY[i];
+            if (nx < 0 || nx >= width || ny < 0 || ny >= height) continue;
+            visit(ny * width + nx, i);
+        }
+    };
+    
+    // Cell states for the raise phase
+    enum : uint8_t { UNTOUCHED = 0, QUEUED = 1, AFFECTED = 2, SUPPORTED = 3 };
+    std::vector<uint8_t> state(static_cast<size_t>(width) * height, UNTOUCHED);
+    std::vector<int> touched;
+    
+    typedef std::pair<float, int> OpenEntry;
+    std::priority_queue<OpenEntry, std::vector<OpenEntry>, std::greater<OpenEntry>> raise_set;
+    
+    // Raise: blocked cells and everything whose value depended on them. Candidates are
+    // decided in increasing value order, so every cheaper neighbor that could support a
+    // candidate has already been decided when it is popped. Goals are the only cells
+    // at zero and are never raised.
+    for (int cell : changed_cells) {
+        if (integration[cell] == 0.0f || integration[cell] == FLT_MAX || state[cell] != UNTOUCHED) continue;
+        // A cell that stays passable may still have become dearer (e.g. re-sampled slope);
+        // the support check below raises it if no neighbor reproduces its old value
+        state[cell] = is_bit_set(passable, cell) ? QUEUED : AFFECTED;
+        raise_set.push(OpenEntry(integration[cell], cell));
+    }
+    
+    while (!raise_set.empty()) {
+        int cell = raise_set.top().second;
+        raise_set.pop();
+        
+        if (state[cell] == QUEUED) {
+            // Still supported if some unaffected neighbor reproduces its value
+            float tolerance = 1e-3f + integration[cell] * 1e-5f;
+            bool supported = false;
+            for_each_neighbor(cell, [&](int p, int dir) {
+                if (supported || state[p] == AFFECTED || integration[p] == FLT_MAX || !is_bit_set(passable, p)) return;
+                // Step p -> cell mirrors cell -> p; diagonal and straight weights are symmetric
+                float value = integration[p] + step_cost[dir] * grid.costs[cell];
+                supported = std::abs(value - integration[cell]) <= tolerance;
+            });
+            
+            if (supported) {
+                state[cell] = SUPPORTED;
+                continue;
+            }
+            state[cell] = AFFECTED;
+        }
+        
+        touched.push_back(cell);
+        
+        for_each_neighbor(cell, [&](int m, int) {
+            if (state[m] != UNTOUCHED || integration[m] == 0.0f || integration[m] == FLT_MAX || !is_bit_set(passable, m)) return;
+            if (integration[m] <= integration[cell]) return;
+            state[m] = QUEUED;
+            raise_set.push(OpenEntry(integration[m], m));
+        });
+    }
+    
+    for (int cell : touched) {
+        integration[cell] = FLT_MAX;
+    }
+    
+    // Seed affected and newly opened cells from their consistent neighbors
+    std::priority_queue<OpenEntry, std::vector<OpenEntry>, std::greater<OpenEntry>> open_set;
+    
+    auto seed = [&](int cell) {
+        if (!is_bit_set(passable, cell)) return;
+        for_each_neighbor(cell, [&](int p, int dir) {
+            if (integration[p] == FLT_MAX || !is_bit_set(passable, p)) return;
+            float value = integration[p] + step_cost[dir] * grid.costs[cell];
+            if (value < integration[cell]) {
+                integration[cell] = value;
+                open_set.push(OpenEntry(value, cell));
+            }
+        });
+    };
+    
+    for (int cell : touched) {
+        seed(cell);
+    }
+    for (int cell : changed_cells) {
+        if (is_bit_set(passable, cell)) {
+            touched.push_back(cell);
+            seed(cell);
+        }
+    }
+    
+    while (!open_set.empty()) {
+        OpenEntry entry = open_set.top();
+        open_set.pop();
+        
+        float dist = entry.first;
+        int cell = entry.second;
+        if (dist > integration[cell]) continue;
+        touched.push_back(cell);
+        
+        // An early-terminated field stays unsettled past its limit
+        if (dist > field.settle_limit) {
+            integration[cell] = FLT_MAX;
+            continue;
+        }
+        
+        for_each_neighbor(cell, [&](int n, int dir) {
+            if (!is_bit_set(passable, n)) return;
+            float value = dist + step_cost[dir] * grid.costs[n];
+            if (value < integration[n]) {
+                integration[n] = value;
+                open_set.push(OpenEntry(value, n));
+            }
+        });
+    }
+    
+    // A corridor cut by the new footprint is widened with a full corridor search
+    // (skipped while a rebuild is in flight; its result replaces this buffer)
+    if (!field.sector_mask.empty() && field.pending_job < 0) {
+        // Past the limit of an early-terminated field only the starts can be told stranded
+        const std::vector<int> &candidates = field.settle_limit == FLT_MAX ? touched : field.start_cells;
+        std::vector<int> stranded;
+        std::vector<uint8_t> stranded_sector(field.sector_mask.size(), 0);
+        for (int cell : candidates) {
+            int sector = get_sector_of_cell(cell);
+            if (integration[cell] == FLT_MAX && is_bit_set(passable, cell) && !stranded_sector[sector]) {
+                stranded_sector[sector] = 1;
+                stranded.push_back(cell);
+            }
+        }
+        
+        if (!stranded.empty()) {
+            std::vector<uint8_t> old_mask = field.sector_mask;
+            find_corridor_sectors(goal_index, stranded, field.sector_mask);
+            if (field.sector_mask != old_mask) {
+                integrate_field(field);
+                return;
+            }
+        }
+    }
+    
+    // Likewise a window the new footprint closed off is widened and rebuilt, and a
+    // start pushed past the limit of an early-terminated field is settled again
+    if (field.pending_job < 0 && !field_reaches_starts(field) && (grow_field_window(field) || field.settle_limit != FLT_MAX)) {
+        integrate_field(field);
+        return;
+    }
+    
+    // Directions only change around cells whose value changed
+    for (int cell : touched) {
+        field.directions[cell] = compute_cell_direction(grid, passable, integration, cell % width, cell / width);
+        for_each_neighbor(cell, [&](int n, int) {
+            field.directions[n] = compute_cell_direction(grid, passable, integration, n % width, n / width);
+        });
+    }
+    
+    // A cell's sight line only depends on the cells toward the goal, so sight lines can only
+    // change if a changed cell was visible or borders a visible cell
+    if (!field.los_bits.empty()) {
+        bool near_sight_line = false;
+        for (int cell : changed_cells) {
+            if (is_bit_set(field.los_bits, cell)) {
+                near_sight_line = true;
+            } else {
+                for_each_neighbor(cell, [&](int n, int) {
+                    near_sight_line = near_sight_line || is_bit_set(field.los_bits, n);
+                });
+            }
+            if (near_sight_line) break;
+        }
+        if (near_sight_line) {
+            compute_line_of_sight(grid, passable, goal_index, field.los_bits);
+        }
+    }
+}
+
+bool FlowFieldManager::has_flow_field(int field_id) const {
+    return field_cache.find(field_id) != field_cache.end();
+}
+
+bool FlowFieldManager::field_covers_position(int field_id, const Vector3 &world_pos) const {
+    auto it = field_cache.find(field_id);
+    if (it == field_cache.end()) {
+        return false;
+    }
+    
+    const FlowField &field = it->second;
+    
+    // Stale pinned fields are refreshed by the re-request this triggers
+    if (field.pin_count > 0) {
+        return !field.needs_rebuild && field.deferred_changes.empty();
+    }
+    if (field.sector_mask.empty() && field.window.is_empty() && field.settle_limit == FLT_MAX) {
+        return true;
+    }
+    
+    Vector2i cell = world_to_grid(world_pos);
+    if (!is_valid_cell(cell.x, cell.y)) {
+        return false;
+    }
+    if (!field.window.is_empty() && !field.window.contains(cell.x, cell.y)) {
+        return false;
+    }
+    if (field_stopped_short_of(field, cell.y * grid_width + cell.x)) {
+        return false;
+    }
+    
+    return field.sector_mask.empty() || field.sector_mask[get_sector_of_cell(cell.y * grid_width + cell.x)] != 0;
+}
+
+void FlowFieldManager::release_flow_field(int field_id) {
+    auto it = field_cache.find(field_id);
+    if (it == field_cache.end()) {
+        return;
+    }
+    
+    FlowField &field = it->second;
+    if (field.goal_indices.size() > 1) {
+        std::vector<int> key = field.goal_indices;
+        key.push_back((int)field.footprint_class);
+        field_by_goal_set.erase(key);
+    } else {
+        field_by_goal.erase(get_field_key(field.goal_cell.y * grid_width + field.goal_cell.x, field.footprint_class));
+    }
+    if (field.pin_count > 0) {
+        static_field_ids.erase(std::remove(static_field_ids.begin(), static_field_ids.end(), field_id), static_field_ids.end());
+    }
+    lru_order.erase(field.lru_position);
+    cache_memory_usage -= field.memory_usage();
+    field_cache.erase(it);
+    
+    if (field_id == current_field_id) {
+        current_field_id = -1;
+    }
+}
+
+void FlowFieldManager::clear_flow_field_cache() {
+    // Static targets stay registered under the same ids (buildings hold them); their
+    // buffers are dropped and rebuilt by refresh_static_fields or on next use
+    std::vector<FlowField> pinned;
+    for (int field_id : static_field_ids) {
+        FlowField &field = field_cache[field_id];
+        if (!is_valid_cell(field.goal_cell.x, field.goal_cell.y)) continue;
+        pinned.push_back(std::move(field));
+    }
+    
+    field_cache.clear();
+    field_by_goal.clear();
+    field_by_goal_set.clear();
+    lru_order.clear();
+    static_field_ids.clear();
+    cache_memory_usage = 0;
+    current_field_id = -1;
+    
+    for (FlowField &field : pinned) {
+        int goal_index = field.goal_cell.y * grid_width + field.goal_cell.x;
+        field.goal_indices.assign(1, goal_index);
+        std::vector<float>().swap(field.integration);
+        std::vector<uint8_t>().swap(field.directions);
+        std::vector<uint64_t>().swap(field.los_bits);
+        std::vector<int>().swap(field.deferred_changes);
+        field.needs_rebuild = true;
+        field.pending_job = -1;
+        
+        const int field_id = field.id;
+        FlowField &kept = field_cache[field_id];
+        kept = std::move(field);
+        lru_order.push_front(field_id);
+        kept.lru_position = lru_order.begin();
+        field_by_goal[get_field_key(goal_index, kept.footprint_class)] = field_id;
+        static_field_ids.push_back(field_id);
+    }
+}
+
+void FlowFieldManager::refresh_static_fields() {
+    for (int field_id : static_field_ids) {
+        refresh_static_field(field_cache[field_id]);
+    }
+}
+
+void FlowFieldManager::touch_field(FlowField &field) {
+    // Move to the front of the LRU list
+    lru_order.splice(lru_order.begin(), lru_order, field.lru_position);
+    field.lru_position = lru_order.begin();
+}
+
+void FlowFieldManager::evict_to_budget() {
+    // Pinned static fields neither count against the budget nor get evicted
+    size_t budget = static_cast<size_t>(cache_budget_mb * 1024.0f * 1024.0f) + get_pinned_memory_usage();
+    
+    // Always keep the most recently used field, even if it alone exceeds the budget
+    auto victim = lru_order.end();
+    while (cache_memory_usage > budget && victim != lru_order.begin() && std::prev(victim) != lru_order.begin()) {
+        --victim;
+        if (field_cache[*victim].pin_count > 0) continue;
+        
+        int field_id = *victim++;
+        release_flow_field(field_id);
+    }
+}
+
+int FlowFieldManager::get_cached_field_count() const {
+    return static_cast<int>(field_cache.size());
+}
+
+int FlowFieldManager::get_cache_memory_usage() const {
+    return static_cast<int>(cache_memory_usage);
+}
+
+int FlowFieldManager::get_grid_memory_usage() const {
+    size_t total = grid.memory_usage() + terrain_costs.capacity() + clearance.capacity() + obstacle_distance.capacity() * sizeof(float) +
+                   density.capacity() * sizeof(float) + congestion_costs.capacity() + density_cells.capacity() * sizeof(int);
+    for (int c = 0; c < FOOTPRINT_CLASS_COUNT; c++) {
+        total += class_walkable_bits[c].capacity() * sizeof(uint64_t);
+    }
+    return static_cast<int>(total);
+}
+
+void FlowFieldManager::rebuild_portal_graph() {
+    // The graph outlives many density splats, so crossings are priced on terrain costs alone
+    CongestionFreeCosts static_costs(*this, true);
+    int old_cols = sector_cols;
+    int old_rows = sector_rows;
+    sector_cols = (grid_width + sector_size - 1) / sector_size;
+    sector_rows = (grid_height + sector_size - 1) / sector_size;
+    const int sector_count = sector_cols * sector_rows;
+    
+    bool same_layout = old_cols == sector_cols && old_rows == sector_rows &&
+            (int)sector_edges_ready.size() == sector_count && (int)sector_cells_dirty.size() == sector_count;
+    
+    // Remember each sector's portal cells to tell which cached cost matrices survive
+    std::vector<std::vector<int>> old_node_cells;
+    if (same_layout) {
+        old_node_cells.resize(sector_count);
+        for (int sector = 0; sector < sector_count; sector++) {
+            for (int node : sector_nodes[sector]) {
+                old_node_cells[sector].push_back(portal_nodes[node].cell);
+            }
+        }
+    }
+    
+    portal_nodes.clear();
+    sector_nodes.assign(sector_count, std::vector<int>());
+    
+    // Entrances along the right and bottom border of every sector
+    for (int sy = 0; sy < sector_rows; sy++) {
+        for (int sx = 0; sx < sector_cols; sx++) {
+            int sector = sy * sector_cols + sx;
+            if (sx + 1 < sector_cols) {
+                add_border_entrances(sector, sector + 1, true);
+            }
+            if (sy + 1 < sector_rows) {
+                add_border_entrances(sector, sector + sector_cols, false);
+            }
+        }
+    }
+    
+    // Intra-sector costs are expensive (one local search per node) and built lazily;
+    // keep those whose cells and portals are unchanged
+    if (!same_layout) {
+        sector_edges_ready.assign(sector_count, 0);
+        sector_edge_costs.assign(sector_count, std::vector<float>());
+    } else {
+        for (int sector = 0; sector < sector_count; sector++) {
+            bool unchanged = !sector_cells_dirty[sector] && old_node_cells[sector].size() == sector_nodes[sector].size();
+            for (size_t i = 0; unchanged && i < sector_nodes[sector].size(); i++) {
+                unchanged = portal_nodes[sector_nodes[sector][i]].cell == old_node_cells[sector][i];
+            }
+            
+            if (!unchanged) {
+                sector_edges_ready[sector] = 0;
+                sector_edge_costs[sector].clear();
+            }
+        }
+    }
+    sector_cells_dirty.assign(sector_count, 0);
+    
+    portal_graph_dirty = false;
+}
+
+void FlowFieldManager::mark_sectors_dirty(const CellRect &rect) {
+    // Nothing cached yet for this layout
+    if (sector_cols == 0 || (int)sector_cells_dirty.size() != sector_cols * sector_rows) {
+        return;
+    }
+    
+    int sx0 = std::max(rect.x0, 0) / sector_size;
+    int sy0 = std::max(rect.y0, 0) / sector_size;
+    int sx1 = std::min(rect.x1 - 1, grid_width - 1) / sector_size;
+    int sy1 = std::min(rect.y1 - 1, grid_height - 1) / sector_size;
+    
+    for (int sy = sy0; sy <= sy1; sy++) {
+        for (int sx = sx0; sx <= sx1; sx++) {
+            sector_cells_dirty[sy * sector_cols + sx] = 1;
+        }
+    }
+}
+
+void FlowFieldManager::add_border_entrances(int sector_a, int sector_b, bool vertical_border) {
+    CellRect rect = get_sector_rect(sector_a);
+    
+    // Border cells on each side: a vertical border runs along y, a horizontal one along x
+    int length = vertical_border ? rect.y1 - rect.y0 : rect.x1 - rect.x0;
+    auto cell_a = [&](int i) {
+        return vertical_border ? (rect.y0 + i) * grid_width + (rect.x1 - 1) : (rect.y1 - 1) * grid_width + (rect.x0 + i);
+    };
+    auto cell_b = [&](int i) {
+        return vertical_border ? cell_a(i) + 1 : cell_a(i) + grid_width;
+    };
+    
+    auto add_entrance = [&](int i) {
+        int a = cell_a(i);
+        int b = cell_b(i);
+        int node_a = static_cast<int>(portal_nodes.size());
+        int node_b = node_a + 1;
+        
+        PortalNode side_a;
+        side_a.cell = a;
+        side_a.sector = sector_a;
+        side_a.slot = static_cast<int>(sector_nodes[sector_a].size());
+        side_a.edges.push_back(std::make_pair(node_b, FLOW_STEP_COST[1] * grid.costs[b]));
+        
+        PortalNode side_b;
+        side_b.cell = b;
+        side_b.sector = sector_b;
+        side_b.slot = static_cast<int>(sector_nodes[sector_b].size());
+        side_b.edges.push_back(std::make_pair(node_a, FLOW_STEP_COST[1] * grid.costs[a]));
+        
+        portal_nodes.push_back(side_a);
+        portal_nodes.push_back(side_b);
+        sector_nodes[sector_a].push_back(node_a);
+        sector_nodes[sector_b].push_back(node_b);
+    };
+    
+    int run_start = -1;
+    for (int i = 0; i <= length; i++) {
+        bool open = i < length && grid.is_walkable(cell_a(i)) && grid.is_walkable(cell_b(i));
+        
+        if (open && run_start < 0) {
+            run_start = i;
+        } else if (!open && run_start >= 0) {
+            int run_length = i - run_start;
+            if (run_length <= MAX_SINGLE_ENTRANCE_LENGTH) {
+                add_entrance(run_start + run_length / 2);
+            } else {
+                add_entrance(run_start);
+                add_entrance(i - 1);
+            }
+            run_start = -1;
+        }
+    }
+}
+
+void FlowFieldManager::ensure_sector_edges(int sector) {
+    if (sector_edges_ready[sector]) {
+        return;
+    }
+    CongestionFreeCosts static_costs(*this, true);     // Cached across splats, like the crossings
+    
+    // Costs between every pair of nodes in the sector (row = from slot, column = to slot)
+    const std::vector<int> &nodes = sector_nodes[sector];
+    const int node_count = static_cast<int>(nodes.size());
+    std::vector<float> &costs = sector_edge_costs[sector];
+    costs.assign(node_count * node_count, FLT_MAX);
+    CellRect rect = get_sector_rect(sector);
+    
+    // Open sectors with a single cost (most of the map) have closed-form octile distances
+    bool uniform = true;
+    uint8_t uniform_cost = grid.costs[rect.y0 * grid_width + rect.x0];
+    for (int y = rect.y0; y < rect.y1 && uniform; y++) {
+        for (int x = rect.x0; x < rect.x1; x++) {
+            int index = y * grid_width + x;
+            if (!grid.is_walkable(index) || grid.costs[index] != uniform_cost) {
+                uniform = false;
+                break;
+            }
+        }
+    }
+    
+    std::vector<float> local;
+    for (int from = 0; from < node_count; from++) {
+        int from_cell = portal_nodes[nodes[from]].cell;
+        if (!uniform) {
+            integrate_local(grid, rect, from_cell, local);
+        }
+        
+        for (int to = 0; to < node_count; to++) {
+            if (to == from) continue;
+            int to_cell = portal_nodes[nodes[to]].cell;
+            
+            if (uniform) {
+                int dx = std::abs(to_cell % grid_width - from_cell % grid_width);
+                int dy = std::abs(to_cell / grid_width - from_cell / grid_width);
+                float octile = FLOW_STEP_COST[1] * std::abs(dx - dy) + FLOW_STEP_COST[0] * std::min(dx, dy);
+                costs[from * node_count + to] = octile * uniform_cost;
+            } else {
+                costs[from * node_count + to] = local[local_index(grid, rect, to_cell)];
+            }
+        }
+    }
+    
+    sector_edges_ready[sector] = 1;
+}
+
+bool FlowFieldManager::find_corridor_sectors(int goal_index, const std::vector<int> &start_cells, std::vector<uint8_t> &sector_mask) {
+    if (portal_graph_dirty) {
+        rebuild_portal_graph();
+    }
+    sector_mask.resize(sector_cols * sector_rows, 0);
+    
+    int goal_sector = get_sector_of_cell(goal_index);
+    sector_mask[goal_sector] = 1;
+    
+    std::vector<float> goal_local;
+    CellRect goal_rect = get_sector_rect(goal_sector);
+    integrate_local(grid, goal_rect, goal_index, goal_local);
+    
+    // Local distances from each start to the portal nodes of its own sector
+    struct StartRoute {
+        int sector = -1;
+        CellRect rect;
+        std::vector<float> local;
+        float best_cost = FLT_MAX;
+        int best_node = -1;
+    };
+    std::vector<StartRoute> routes;
+    std::unordered_map<int, std::vector<int>> routes_by_sector;
+    bool routed = false;
+    
+    for (int start : start_cells) {
+        int start_sector = get_sector_of_cell(start);
+        
+        // Always mark the start sector so an unreachable start is not re-searched every frame
+        sector_mask[start_sector] = 1;
+        
+        if (start_sector == goal_sector && goal_local[local_index(grid, goal_rect, start)] < FLT_MAX) {
+            routed = true;
+            continue;
+        }
+        
+        StartRoute route;
+        route.sector = start_sector;
+        route.rect = get_sector_rect(start_sector);
+        integrate_local(grid, route.rect, start, route.local);
+        
+        bool has_exit = false;
+        for (int node : sector_nodes[start_sector]) {
+            has_exit = has_exit || route.local[local_index(grid, route.rect, portal_nodes[node].cell)] < FLT_MAX;
+        }
+        if (!has_exit) continue;
+        
+        routes_by_sector[start_sector].push_back(static_cast<int>(routes.size()));
+        routes.push_back(route);
+    }
+    
+    // Abstract Dijkstra from the goal, seeded with the portal nodes reachable inside its sector
+    std::vector<float> node_dist(portal_nodes.size(), FLT_MAX);
+    std::vector<int> node_parent(portal_nodes.size(), -1);
+    
+    typedef std::pair<float, int> OpenEntry;
+    std::priority_queue<OpenEntry, std::vector<OpenEntry>, std::greater<OpenEntry>> open_set;
+    
+    for (int node : sector_nodes[goal_sector]) {
+        float dist = goal_local[local_index(grid, goal_rect, portal_nodes[node].cell)];
+        if (dist < FLT_MAX) {
+            node_dist[node] = dist;
+            open_set.push(OpenEntry(dist, node));
+        }
+    }
+    
+    size_t unsettled_routes = routes.size();
+    
+    while (!open_set.empty() && unsettled_routes > 0) {
+        OpenEntry entry = open_set.top();
+        open_set.pop();
+        
+        float dist = entry.first;
+        int node = entry.second;
+        if (dist > node_dist[node]) continue;
+        
+        // Stop once every start's best exit is cheaper than anything left in the queue
+        unsettled_routes = 0;
+        for (StartRoute &route : routes) {
+            if (route.best_cost > dist) {
+                unsettled_routes++;
+            }
+        }
+        if (unsettled_routes == 0) break;
+        
+        int sector = portal_nodes[node].sector;
+        auto starts_here = routes_by_sector.find(sector);
+        if (starts_here != routes_by_sector.end()) {
+            for (int r : starts_here->second) {
+                StartRoute &route = routes[r];
+                float local = route.local[local_index(grid, route.rect, portal_nodes[node].cell)];
+                if (local < FLT_MAX && dist + local < route.best_cost) {
+                    route.best_cost = dist + local;
+                    route.best_node = node;
+                }
+            }
+        }
+        
+        auto relax = [&](int next, float cost) {
+            float new_dist = dist + cost;
+            if (new_dist < node_dist[next]) {
+                node_dist[next] = new_dist;
+                node_parent[next] = node;
+                open_set.push(OpenEntry(new_dist, next));
+            }
+        };
+        
+        // Crossing edges, then the other portals of this sector
+        for (const std::pair<int, float> &edge : portal_nodes[node].edges) {
+            relax(edge.first, edge.second);
+        }
+        
+        ensure_sector_edges(sector);
+        const std::vector<int> &nodes = sector_nodes[sector];
+        const std::vector<float> &costs = sector_edge_costs[sector];
+        const int node_count = static_cast<int>(nodes.size());
+        const int slot = portal_nodes[node].slot;
+        for (int other = 0; other < node_count; other++) {
+            float cost = costs[slot * node_count + other];
+            if (other != slot && cost < FLT_MAX) {
+                relax(nodes[other], cost);
+            }
+        }
+    }
+    
+    // Walk each start's cheapest exit back to the goal, marking the sectors it crosses
+    for (const StartRoute &route : routes) {
+        if (route.best_node < 0) continue;
+        
+        routed = true;
+        for (int node = route.best_node; node >= 0; node = node_parent[node]) {
+            sector_mask[portal_nodes[node].sector] = 1;
+        }
+    }
+    
+    return routed;
+}
+
+int FlowFieldManager::get_sector_of_cell(int cell_index) const {
+    int x = cell_index % grid_width;
+    int y = cell_index / grid_width;
+    return (y / sector_size) * sector_cols + (x / sector_size);
+}
+
+CellRect FlowFieldManager::get_sector_rect(int sector) const {
+    CellRect rect;
+    rect.x0 = (sector % sector_cols) * sector_size;
+    rect.y0 = (sector / sector_cols) * sector_size;
+    rect.x1 = std::min(rect.x0 + sector_size, grid_width);
+    rect.y1 = std::min(rect.y0 + sector_size, grid_height);
+    return rect;
+}
+
+int FlowFieldManager::get_portal_count() const {
+    return static_cast<int>(portal_nodes.size() / 2);
+}
+
+Vector3 FlowFieldManager::get_flow_direction(const Vector3 &world_pos) const {
+    return get_flow_direction_for(current_field_id, world_pos);
+}
+
+Vector3 FlowFieldManager::get_flow_direction_for(int field_id, const Vector3 &world_pos) const {
+    auto it = field_cache.find(field_id);
+    if (it == field_cache.end()) {
+        return Vector3(0, 0, 0);
+    }
+    
+    Vector2i cell = world_to_grid(world_pos);
+    
+    // First buffer still building
+    const FlowField &field = it->second;
+    if (!is_valid_cell(cell.x, cell.y) || field.directions.empty()) {
+        return Vector3(0, 0, 0);
+    }
+    
+    int index = cell.y * grid_width + cell.x;
+    if (!field.los_bits.empty() && is_bit_set(field.los_bits, index)) {
+        return get_line_of_sight_direction(field, world_pos);
+    }
+    
+    return FLOW_DIR_VECTORS[field.directions[index]];
+}
+
+Vector3 FlowFieldManager::get_line_of_sight_direction(const FlowField &field, const Vector3 &world_pos) const {
+    Vector3 to_goal = field.target - world_pos;
+    to_goal.y = 0;
+    
+    // Inside the goal cell the unit arrives on its own
+    float length_sq = to_goal.length_squared();
+    if (length_sq < 1e-6f) {
+        return Vector3(0, 0, 0);
+    }
+    return to_goal / std::sqrt(length_sq);
+}
+
+Vector3 FlowFieldManager::get_flow_lookahead_point(int field_id, const Vector3 &world_pos, float lookahead_distance) const {
+    auto it = field_cache.find(field_id);
+    Vector2i cell = world_to_grid(world_pos);
+    if (it == field_cache.end() || it->second.directions.empty() || !is_valid_cell(cell.x, cell.y)) {
+        return world_pos;
+    }
+    
+    const FlowField &field = it->second;
+    int index = cell.y * grid_width + cell.x;
+    
+    // Line of sight was computed on the field's own walkability, so the goal itself is a safe aim
+    if (!field.los_bits.empty() && is_bit_set(field.los_bits, index)) {
+        Vector3 to_goal = field.target - world_pos;
+        to_goal.y = 0;
+        float distance = to_goal.length();
+        return distance <= lookahead_distance ? field.target : world_pos + to_goal * (lookahead_distance / distance);
+    }
+    
+    // Follow the packed directions until the traced path is as long as the lookahead
+    int trace[MAX_LOOKAHEAD_STEPS];
+    int steps = 0;
+    float traced = 0.0f;
+    int x = cell.x;
+    int y = cell.y;
+    
+    // Wide vehicles pushed into their clearance margin rejoin the field at the cheapest nearby cell
+    if (field.directions[index] == FLOW_DIR_NONE && field.integration[index] != 0.0f) {
+        float best = FLT_MAX;
+        for (int ny = std::max(cell.y - LOOKAHEAD_RECOVERY_RADIUS, 0); ny <= std::min(cell.y + LOOKAHEAD_RECOVERY_RADIUS, grid_height - 1); ny++) {
+            for (int nx = std::max(cell.x - LOOKAHEAD_RECOVERY_RADIUS, 0); nx <= std::min(cell.x + LOOKAHEAD_RECOVERY_RADIUS, grid_width - 1); nx++) {
+                float value = field.integration[ny * grid_width + nx];
+                if (value < best) {
+                    best = value;
+                    x = nx;
+                    y = ny;
+                }
+            }
+        }
+        if (best == FLT_MAX) {
+            return world_pos;
+        }
+        trace[steps++] = y * grid_width + x;
+    }
+    
+    while (steps < MAX_LOOKAHEAD_STEPS && (steps == 0 || traced < lookahead_distance)) {
+        uint8_t direction = field.directions[y * grid_width + x];
+        if (direction == FLOW_DIR_NONE) break;
+        
+        x += FLOW_DX[direction];
+        y += FLOW_DY[direction];
+        traced += FLOW_STEP_COST[direction] * cell_size;
+        trace[steps++] = y * grid_width + x;
+    }
+    if (steps == 0) {
+        return world_pos;
+    }
+    
+    // Aim at the farthest traced cell the vehicle can reach in a straight line
+    const std::vector<uint64_t> &passable = get_class_walkable_bits(field.footprint_class);
+    int aim = 0;
+    for (int i = steps - 1; i > 0; i--) {
+        if (segment_clear(grid, passable, cell.y * grid_width + cell.x, trace[i], FLOW_COST_IMPASSABLE)) {
+            aim = i;
+            break;
+        }
+    }
+    
+    Vector3 point = grid_to_world(trace[aim] % grid_width, trace[aim] / grid_width);
+    point.y = world_pos.y;
+    return point;
+}
+
+// Nearest passable cell within radius of (x, y), or -1
+static int find_open_cell(const FlowGrid &grid, const std::vector<uint64_t> &passable, int x, int y, int radius) {
+    int best = -1;
+    int best_distance = INT_MAX;
+    for (int ny = std::max(y - radius, 0); ny <= std::min(y + radius, grid.height - 1); ny++) {
+        for (int nx = std::max(x - radius, 0); nx <= std::min(x + radius, grid.width - 1); nx++) {
+            int distance = (nx - x) * (nx - x) + (ny - y) * (ny - y);
+            if (distance < best_distance && is_bit_set(passable, ny * grid.width + nx)) {
+                best_distance = distance;
+                best = ny * grid.width + nx;
+            }
+        }
+    }
+    return best;
+}
+
+PackedVector3Array FlowFieldManager::find_path(const Vector3 &from, const Vector3 &to, int footprint_class) {
+    PackedVector3Array points;
+    Vector2i start_cell = world_to_grid(from);
+    Vector2i goal_cell = world_to_grid(to);
+    if (grid.costs.empty() || !is_valid_cell(start_cell.x, start_cell.y) || !is_valid_cell(goal_cell.x, goal_cell.y)) {
+        return points;
+    }
+    
+    uint64_t start_usec = Time::get_singleton()->get_ticks_usec();
+    FootprintClass size_class = (FootprintClass)Math::clamp(footprint_class, 0, FOOTPRINT_CLASS_COUNT - 1);
+    const std::vector<uint64_t> &passable = get_class_walkable_bits(size_class);
+    
+    int start = find_open_cell(grid, passable, start_cell.x, start_cell.y, PATH_ENDPOINT_RECOVERY_RADIUS);
+    int goal = find_open_cell(grid, passable, goal_cell.x, goal_cell.y, PATH_ENDPOINT_RECOVERY_RADIUS);
+    
+    // Unreachable or over-budget searches return no path; callers fall back to a flow field,
+    // which is built off the main thread
+    if (start < 0 || goal < 0 ||
+            !find_path_astar(grid, passable, start, goal, path_scratch, path_cells, path_heuristic_weight, path_max_expansions)) {
+        last_path_time_ms = (Time::get_singleton()->get_ticks_usec() - start_usec) / 1000.0f;
+        return points;
+    }
+    smooth_path(grid, passable, path_cells);
+    
+    // The unit is already in the first cell; the exact order position replaces the goal cell centre
+    const bool exact_goal = goal == goal_cell.y * grid_width + goal_cell.x;
+    for (size_t i = 1; i < path_cells.size(); i++) {
+        Vector3 point = grid_to_world(path_cells[i] % grid_width, path_cells[i] / grid_width);
+        point.y = to.y;
+        points.push_back(point);
+    }
+    if (points.is_empty()) {
+        Vector3 point = exact_goal ? to : grid_to_world(goal % grid_width, goal / grid_width);
+        point.y = to.y;
+        points.push_back(point);
+    } else if (exact_goal) {
+        points.set(points.size() - 1, to);
+    }
+    
+    last_path_time_ms = (Time::get_singleton()->get_ticks_usec() - start_usec) / 1000.0f;
+    return points;
+}
+
+bool FlowFieldManager::should_use_path(int unit_count) const {
+    return unit_count > 0 && unit_count <= path_unit_threshold && !grid.costs.empty();
+}
+
+int FlowFieldManager::get_walkability_version() const {
+    return walkability_version;
+}
+
+float FlowFieldManager::get_last_path_time_ms() const {
+    return last_path_time_ms;
+}
+
+PackedVector3Array FlowFieldManager::get_flow_directions(int field_id, const PackedVector3Array &world_positions) const {
+    PackedVector3Array result;
+    const int count = world_positions.size();
+    result.resize(count);
+    
+    auto it = field_cache.find(field_id);
+    if (it == field_cache.end() || it->second.directions.empty()) {
+        result.fill(Vector3(0, 0, 0));
+        return result;
+    }
+    
+    const FlowField &field = it->second;
+    const uint8_t *directions = field.directions.data();
+    const bool has_los = !field.los_bits.empty();
+    const Vector3 *positions = world_positions.ptr();
+    Vector3 *out = result.ptrw();
+    const float inv_cell = 1.0f / cell_size;
+    const int max_x = grid_width - 1;
+    const int max_y = grid_height - 1;
+    
+    // Corner indices and bilinear weights are computed branch-free for a block,
+    // then the direction table is gathered per corner
+    int corner[4][FLOW_SAMPLE_BLOCK];
+    float weight[4][FLOW_SAMPLE_BLOCK];
+    int own[FLOW_SAMPLE_BLOCK];
+    uint8_t inside[FLOW_SAMPLE_BLOCK];
+    
+    for (int base = 0; base < count; base += FLOW_SAMPLE_BLOCK) {
+        const int n = std::min(FLOW_SAMPLE_BLOCK, count - base);
+        
+        for (int i = 0; i < n; i++) {
+            // Continuous coordinates relative to cell centers
+            float u = (positions[base + i].x - grid_origin.x) * inv_cell - 0.5f;
+            float v = (positions[base + i].z - grid_origin.z) * inv_cell - 0.5f;
+            float fu = std::floor(u);
+            float fv = std::floor(v);
+            float tx = u - fu;
+            float ty = v - fv;
+            int x0 = std::min(std::max((int)fu, 0), max_x);
+            int y0 = std::min(std::max((int)fv, 0), max_y);
+            int x1 = std::min(std::max((int)fu + 1, 0), max_x);
+            int y1 = std::min(std::max((int)fv + 1, 0), max_y);
+            
+            corner[0][i] = y0 * grid_width + x0;
+            corner[1][i] = y0 * grid_width + x1;
+            corner[2][i] = y1 * grid_width + x0;
+            corner[3][i] = y1 * grid_width + x1;
+            weight[0][i] = (1.0f - tx) * (1.0f - ty);
+            weight[1][i] = tx * (1.0f - ty);
+            weight[2][i] = (1.0f - tx) * ty;
+            weight[3][i] = tx * ty;
+            
+            int cx = (int)std::floor(u + 0.5f);
+            int cy = (int)std::floor(v + 0.5f);
+            inside[i] = cx >= 0 && cx <= max_x && cy >= 0 && cy <= max_y;
+            own[i] = std::min(std::max(cy, 0), max_y) * grid_width + std::min(std::max(cx, 0), max_x);
+        }
+        
+        for (int i = 0; i < n; i++) {
+            // Same as the single-cell query: no guidance off the grid
+            if (!inside[i]) {
+                out[base + i] = Vector3(0, 0, 0);
+                continue;
+            }
+            
+            if (has_los && is_bit_set(field.los_bits, own[i])) {
+                out[base + i] = get_line_of_sight_direction(field, positions[base + i]);
+                continue;
+            }
+            
+            float dx = 0.0f;
+            float dz = 0.0f;
+            for (int c = 0; c < 4; c++) {
+                // Goal and blocked cells store FLOW_DIR_NONE, whose vector is zero
+                uint8_t dir = directions[corner[c][i]];
+                dx += FLOW_DIR_X[dir] * weight[c][i];
+                dz += FLOW_DIR_Z[dir] * weight[c][i];
+            }
+            
+            float length_sq = dx * dx + dz * dz;
+            if (length_sq > 1e-4f) {
+                float inv_length = 1.0f / std::sqrt(length_sq);
+                out[base + i] = Vector3(dx * inv_length, 0, dz * inv_length);
+            } else {
+                // Opposing neighbors cancel out (e.g. on a watershed); use the cell's own direction
+                out[base + i] = FLOW_DIR_VECTORS[directions[own[i]]];
+            }
+        }
+    }
+    
+    return result;
+}
+
+bool FlowFieldManager::is_position_walkable(const Vector3 &world_pos) const {
+    Vector2i cell = world_to_grid(world_pos);
+    
+    // Nothing is walkable before the first update_walkability
+    if (!is_valid_cell(cell.x, cell.y) || grid.walkable_bits.empty()) {
+        return false;
+    }
+    
+    return grid.is_walkable(cell.y * grid_width + cell.x);
+}
+
+Vector2i FlowFieldManager::world_to_grid(const Vector3 &world_pos) const {
+    int x = static_cast<int>((world_pos.x - grid_origin.x) / cell_size);
+    int y = static_cast<int>((world_pos.z - grid_origin.z) / cell_size);
+    return Vector2i(x, y);
+}
+
+Vector3 FlowFieldManager::grid_to_world(int x, int y) const {
+    return Vector3(
+        grid_origin.x + (x + 0.5f) * cell_size,
+        grid_origin.y,
+        grid_origin.z + (y + 0.5f) * cell_size
+    );
+}
+
+bool FlowFieldManager::is_valid_cell(int x, int y) const {
+    return x >= 0 && x < grid_width && y >= 0 && y < grid_height;
+}
+
+void FlowFieldManager::set_grid_size(int width, int height) {
+    grid_width = width;
+    grid_height = height;
+}
+
+Vector2i FlowFieldManager::get_grid_size() const {
+    return Vector2i(grid_width, grid_height);
+}
+
+void FlowFieldManager::set_cell_size(float size) {
+    cell_size = size;
+}
+
+float FlowFieldManager::get_cell_size() const {
+    return cell_size;
+}
+
+void FlowFieldManager::set_grid_origin(const Vector3 &origin) {
+    grid_origin = origin;
+}
+
+Vector3 FlowFieldManager::get_grid_origin() const {
+    return grid_origin;
+}
+
+void FlowFieldManager::set_debug_draw(bool enabled) {
+    debug_draw = enabled;
+}
+
+bool FlowFieldManager::get_debug_draw() const {
+    return debug_draw;
+}
+
+void FlowFieldManager::set_cache_budget_mb(float budget) {
+    cache_budget_mb = budget;
+    evict_to_budget();
+}
+
+float FlowFieldManager::get_cache_budget_mb() const {
+    return cache_budget_mb;
+}
+
+void FlowFieldManager::set_integration_engine(int engine) {
+    integration_engine = static_cast<IntegrationEngine>(Math::clamp(engine, 0, 1));
+}
+
+int FlowFieldManager::get_integration_engine() const {
+    return static_cast<int>(integration_engine);
+}
+
+void FlowFieldManager::set_use_hierarchical_search(bool enabled) {
+    use_hierarchical_search = enabled;
+}
+
+bool FlowFieldManager::get_use_hierarchical_search() const {
+    return use_hierarchical_search;
+}
+
+void FlowFieldManager::set_use_threaded_computation(bool enabled) {
+    use_threaded_computation = enabled;
+}
+
+bool FlowFieldManager::get_use_threaded_computation() const {
+    return use_threaded_computation;
+}
+
+void FlowFieldManager::set_use_line_of_sight(bool enabled) {
+    use_line_of_sight = enabled;
+}
+
+bool FlowFieldManager::get_use_line_of_sight() const {
+    return use_line_of_sight;
+}
+
+void FlowFieldManager::set_use_windowed_search(bool enabled) {
+    use_windowed_search = enabled;
+}
+
+bool FlowFieldManager::get_use_windowed_search() const {
+    return use_windowed_search;
+}
+
+void FlowFieldManager::set_window_padding(int padding) {
+    window_padding = padding < 2 ? 2 : padding;
+}
+
+int FlowFieldManager::get_window_padding() const {
+    return window_padding;
+}
+
+void FlowFieldManager::set_use_early_termination(bool enabled) {
+    use_early_termination = enabled;
+}
+
+bool FlowFieldManager::get_use_early_termination() const {
+    return use_early_termination;
+}
+
+void FlowFieldManager::set_termination_margin(float margin) {
+    termination_margin = margin < 0.0f ? 0.0f : margin;
+}
+
+float FlowFieldManager::get_termination_margin() const {
+    return termination_margin;
+}
+
+void FlowFieldManager::set_sector_size(int size) {
+    sector_size = size < 4 ? 4 : size;
+    
+    // Corridor masks are indexed by sector
+    clear_flow_field_cache();
+    sector_edges_ready.clear();
+    portal_graph_dirty = true;
+    refresh_static_fields();
+}
+
+int FlowFieldManager::get_sector_size() const {
+    return sector_size;
+}
+
+void FlowFieldManager::set_max_walkable_slope(float slope) {
+    max_walkable_slope = slope;
+}
+
+float FlowFieldManager::get_max_walkable_slope() const {
+    return max_walkable_slope;
+}
+
+void FlowFieldManager::set_max_height_difference(float difference) {
+    max_height_difference = difference;
+}
+
+float FlowFieldManager::get_max_height_difference() const {
+    return max_height_difference;
+}
+
+void FlowFieldManager::set_slope_cost_scale(float scale) {
+    slope_cost_scale = scale < 0.0f ? 0.0f : scale;
+}
+
+float FlowFieldManager::get_slope_cost_scale() const {
+    return slope_cost_scale;
+}
+
+void FlowFieldManager::set_use_density_costs(bool enabled) {
+    bool was_enabled = use_density_costs;
+    use_density_costs = enabled;
+    
+    // Fold the congestion back out of the cell costs
+    if (was_enabled && !enabled) {
+        update_density(PackedVector3Array());
+    }
+}
+
+bool FlowFieldManager::get_use_density_costs() const {
+    return use_density_costs;
+}
+
+void FlowFieldManager::set_density_update_interval(float interval) {
+    density_update_interval = interval < 0.05f ? 0.05f : interval;
+}
+
+float FlowFieldManager::get_density_update_interval() const {
+    return density_update_interval;
+}
+
+void FlowFieldManager::set_density_decay(float decay) {
+    density_decay = Math::clamp(decay, 0.0f, 0.95f);
+}
+
+float FlowFieldManager::get_density_decay() const {
+    return density_decay;
+}
+
+void FlowFieldManager::set_density_cost_scale(float scale) {
+    density_cost_scale = scale < 0.0f ? 0.0f : scale;
+}
+
+float FlowFieldManager::get_density_cost_scale() const {
+    return density_cost_scale;
+}
+
+void FlowFieldManager::set_congestion_repair_interval(float interval) {
+    congestion_repair_interval = Math::clamp(interval, 0.0f, 10.0f);
+}
+
+float FlowFieldManager::get_congestion_repair_interval() const {
+    return congestion_repair_interval;
+}
+
+void FlowFieldManager::set_max_density_cost(int cost) {
+    max_density_cost = Math::clamp(cost, 0, 64);
+}
+
+int FlowFieldManager::get_max_density_cost() const {
+    return max_density_cost;
+}
+
+void FlowFieldManager::set_path_unit_threshold(int threshold) {
+    path_unit_threshold = Math::clamp(threshold, 0, 64);
+}
+
+int FlowFieldManager::get_path_unit_threshold() const {
+    return path_unit_threshold;
+}
+
+void FlowFieldManager::set_path_heuristic_weight(float weight) {
+    path_heuristic_weight = Math::clamp(weight, 1.0f, 3.0f);
+}
+
+float FlowFieldManager::get_path_heuristic_weight() const {
+    return path_heuristic_weight;
+}
+
+void FlowFieldManager::set_path_max_expansions(int expansions) {
+    path_max_expansions = std::max(0, expansions);
+}
+
+int FlowFieldManager::get_path_max_expansions() const {
+    return path_max_expansions;
+}
+
+void FlowFieldManager::set_persist_static_fields(bool enabled) {
+    persist_static_fields = enabled;
+}
+
+bool FlowFieldManager::get_persist_static_fields() const {
+    return persist_static_fields;
+}
+
+void FlowFieldManager::set_static_field_directory(const String &directory) {
+    static_field_directory = directory;
+}
+
+String FlowFieldManager::get_static_field_directory() const {
+    return static_field_directory;
+}
+
+void FlowFieldManager::set_footprint_radius(int footprint_class, float radius) {
+    if (footprint_class < 0 || footprint_class >= FOOTPRINT_CLASS_COUNT) {
+        return;
+    }
+    footprint_radius[footprint_class] = radius;
+    
+    // Thresholds and the clearance cap changed; rebuild once the grid exists
+    if (!clearance.empty()) {
+        clearance.clear();
+        CellRect full;
+        full.x1 = grid_width;
+        full.y1 = grid_height;
+        update_clearance(full, nullptr);
+        clear_flow_field_cache();
+        refresh_static_fields();
+    }
+}
+
+float FlowFieldManager::get_footprint_radius(int footprint_class) const {
+    if (footprint_class < 0 || footprint_class >= FOOTPRINT_CLASS_COUNT) {
+        return 0.0f;
+    }
+    return footprint_radius[footprint_class];
 }
 
 bool FlowFieldManager::is_field_valid() const {
-    return field_computed;
+    return has_flow_field(current_field_id);
 }
 
 void FlowFieldManager::draw_debug_field() {
@@ -18,6 +18,8 @@
 #include "TerrainGenerator.h"
 #include "SelectionManager.h"
 #include "FlowFieldManager.h"
+#include "SpatialHash.h"
+#include "CrowdSystem.h"
 #include "UnitSpawner.h"
 #include "GameManager.h"
 
@@ -39,6 +41,8 @@ void initialize_rts_module(ModuleInitializationLevel p_level) {
     ClassDB::register_class<rts::TerrainGenerator>();
     ClassDB::register_class<rts::SelectionManager>();
     ClassDB::register_class<rts::FlowFieldManager>();
+    ClassDB::register_class<rts::SpatialHash>();
+    ClassDB::register_class<rts::CrowdSystem>();
     ClassDB::register_class<rts::UnitSpawner>();
     ClassDB::register_class<rts::GameManager>();
 }
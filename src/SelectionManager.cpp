@@ -89,7 +89,7 @@ void SelectionManager::_input(const Ref<InputEvent> &event) {
             }
         } else if (mouse_button->get_button_index() == MouseButton::MOUSE_BUTTON_RIGHT) {
             if (mouse_button->is_pressed()) {
-                handle_right_click(pos);
+                handle_right_click(pos, mouse_button->is_shift_pressed());
             }
         }
     }
@@ -193,7 +193,7 @@ void SelectionManager::handle_left_click(const Vector2 &position, bool shift_hel
     }
 }
 
-void SelectionManager::handle_right_click(const Vector2 &position) {
+void SelectionManager::handle_right_click(const Vector2 &position, bool shift_held) {
     if (selected_units.size() == 0) {
         return;
     }
@@ -201,7 +201,7 @@ void SelectionManager::handle_right_click(const Vector2 &position) {
     Vector3 target = raycast_for_ground(position);
     
     if (target != Vector3(0, -1000, 0)) { // Check for valid hit
-        issue_move_order(target);
+        issue_move_order(target, shift_held);
     }
 }
 
@@ -328,23 +328,71 @@ void SelectionManager::show_selection_rect(bool visible) {
     }
 }
 
-void SelectionManager::issue_move_order(const Vector3 &target) {
-    // Compute flow field if manager is available
+void SelectionManager::issue_move_order(const Vector3 &target, bool queued) {
+    // Small selections plan individual A* paths; building a whole field would cost far more
+    if (flow_field_manager && flow_field_manager->should_use_path(selected_units.size())) {
+        int version = flow_field_manager->get_walkability_version();
+        for (int i = 0; i < selected_units.size(); i++) {
+            Unit *unit = selected_units[i];
+            if (!unit) continue;
+            
+            if (queued && unit->get_has_move_order()) {
+                unit->queue_move_target(target);
+                continue;
+            }
+            unit->set_move_target(target);
+            
+            // Unreachable by A* leaves the unit without a path, and UnitSpawner gives it a field
+            PackedVector3Array path = flow_field_manager->find_path(unit->get_global_position(), target);
+            if (!path.is_empty()) {
+                unit->set_path(path, version);
+            }
+        }
+        
+        emit_signal("move_order_issued", target);
+        return;
+    }
+    
+    // Get (or build) the cached flow field for this target; unit positions let the
+    // manager integrate only the sectors between the group and the goal. A queued
+    // leg starts where each unit's current orders end instead
+    int field_id = -1;
+    PackedVector3Array start_positions;
+    PackedVector3Array flows;
     if (flow_field_manager) {
-        flow_field_manager->compute_flow_field(target);
+        for (int i = 0; i < selected_units.size(); i++) {
+            Unit *unit = selected_units[i];
+            if (unit) {
+                bool behind_orders = queued && unit->get_has_move_order();
+                start_positions.push_back(behind_orders ? unit->get_final_target() : unit->get_global_position());
+            }
+        }
+        field_id = flow_field_manager->request_flow_field(target, start_positions);
+        
+        // One batched query for the whole selection
+        if (field_id != -1) {
+            flows = flow_field_manager->get_flow_directions(field_id, start_positions);
+        }
     }
     
     // Issue move orders to all selected units
+    int flow_index = 0;
     for (int i = 0; i < selected_units.size(); i++) {
         Unit *unit = selected_units[i];
         if (unit) {
+            if (queued && unit->get_has_move_order()) {
+                unit->queue_move_target(target, field_id);
+                flow_index++;
+                continue;
+            }
             unit->set_move_target(target);
             
             // Apply flow vector if available
-            if (flow_field_manager) {
-                Vector3 flow = flow_field_manager->get_flow_direction(unit->get_global_position());
-                unit->apply_flow_vector(flow);
+            if (flow_field_manager && field_id != -1) {
+                unit->set_flow_field_id(field_id);
+                unit->apply_flow_vector(flows[flow_index]);
             }
+            flow_index++;
         }
     }
     
@@ -0,0 +1,173 @@
+/**
+ * SpatialHash.cpp
+ * Uniform grid hash of unit and vehicle positions for neighbour queries.
+ */
+
+#include "SpatialHash.h"
+
+#include <godot_cpp/classes/engine.hpp>
+#include <godot_cpp/classes/time.hpp>
+
+#include <cfloat>
+
+using namespace godot;
+
+namespace rts {
+
+// Rebuild before units and vehicles run their physics step
+static const int SPATIAL_HASH_PHYSICS_PRIORITY = -100;
+
+void SpatialHash::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("register_entity", "node", "layer"), &SpatialHash::register_entity);
+    ClassDB::bind_method(D_METHOD("unregister_entity", "node"), &SpatialHash::unregister_entity);
+    ClassDB::bind_method(D_METHOD("get_entity_count"), &SpatialHash::get_entity_count);
+    ClassDB::bind_method(D_METHOD("rebuild"), &SpatialHash::rebuild);
+    ClassDB::bind_method(D_METHOD("get_neighbors", "position", "radius", "layer_mask"), &SpatialHash::get_neighbors, DEFVAL(SPATIAL_LAYER_UNITS | SPATIAL_LAYER_VEHICLES));
+    ClassDB::bind_method(D_METHOD("find_nearest", "position", "radius", "layer_mask", "exclude"), &SpatialHash::find_nearest, DEFVAL(SPATIAL_LAYER_UNITS | SPATIAL_LAYER_VEHICLES), DEFVAL(Variant()));
+    ClassDB::bind_method(D_METHOD("get_last_rebuild_ms"), &SpatialHash::get_last_rebuild_ms);
+    
+    ClassDB::bind_method(D_METHOD("set_cell_size", "size"), &SpatialHash::set_cell_size);
+    ClassDB::bind_method(D_METHOD("get_cell_size"), &SpatialHash::get_cell_size);
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "cell_size", PROPERTY_HINT_RANGE, "0.5,16.0,0.1"), "set_cell_size", "get_cell_size");
+}
+
+SpatialHash::SpatialHash() {
+}
+
+SpatialHash::~SpatialHash() {
+}
+
+void SpatialHash::_ready() {
+    if (Engine::get_singleton()->is_editor_hint()) {
+        return;
+    }
+    
+    set_physics_process_priority(SPATIAL_HASH_PHYSICS_PRIORITY);
+    set_physics_process(true);
+}
+
+void SpatialHash::_physics_process(double delta) {
+    if (Engine::get_singleton()->is_editor_hint()) {
+        return;
+    }
+    
+    rebuild();
+}
+
+void SpatialHash::register_entity(Node3D *node, int layer) {
+    if (!node) {
+        return;
+    }
+    
+    auto existing = registered_index.find(node);
+    if (existing != registered_index.end()) {
+        registered[existing->second].layer = static_cast<uint32_t>(layer);
+        return;
+    }
+    
+    Registration registration;
+    registration.node = node;
+    registration.layer = static_cast<uint32_t>(layer);
+    registered_index[node] = static_cast<int>(registered.size());
+    registered.push_back(registration);
+}
+
+void SpatialHash::unregister_entity(Node3D *node) {
+    auto it = registered_index.find(node);
+    if (it == registered_index.end()) {
+        return;
+    }
+    
+    int index = it->second;
+    registered_index.erase(it);
+    if (index != static_cast<int>(registered.size()) - 1) {
+        registered[index] = registered.back();
+        registered_index[registered[index].node] = index;
+    }
+    registered.pop_back();
+    
+    // The node may be freed before the next rebuild; its snapshot stays in place but matches no layer
+    for (Entry &entry : entries) {
+        if (entry.node == node) {
+            entry.node = nullptr;
+            entry.layer = 0;
+        }
+    }
+}
+
+int SpatialHash::get_entity_count() const {
+    return static_cast<int>(registered.size());
+}
+
+void SpatialHash::rebuild() {
+    uint64_t start_usec = Time::get_singleton()->get_ticks_usec();
+    const int count = static_cast<int>(registered.size());
+    
+    // Power-of-two bucket count at about twice the entity count keeps collisions rare
+    uint32_t bucket_count = 16;
+    while (bucket_count < static_cast<uint32_t>(count) * 2) {
+        bucket_count <<= 1;
+    }
+    bucket_mask = bucket_count - 1;
+    
+    // One position read per entity, then a counting sort by bucket
+    unsorted_entries.resize(count);
+    bucket_of.resize(count);
+    bucket_start.assign(bucket_count + 1, 0);
+    for (int i = 0; i < count; i++) {
+        Entry &entry = unsorted_entries[i];
+        entry.node = registered[i].node;
+        entry.layer = registered[i].layer;
+        entry.position = entry.node->get_global_position();
+        entry.cell_x = cell_coord(entry.position.x);
+        entry.cell_z = cell_coord(entry.position.z);
+        
+        bucket_of[i] = hash_cell(entry.cell_x, entry.cell_z) & bucket_mask;
+        bucket_start[bucket_of[i] + 1]++;
+    }
+    for (uint32_t b = 0; b < bucket_count; b++) {
+        bucket_start[b + 1] += bucket_start[b];
+    }
+    
+    entries.resize(count);
+    bucket_fill.assign(bucket_start.begin(), bucket_start.end() - 1);
+    for (int i = 0; i < count; i++) {
+        entries[bucket_fill[bucket_of[i]]++] = unsorted_entries[i];
+    }
+    
+    last_rebuild_ms = (Time::get_singleton()->get_ticks_usec() - start_usec) / 1000.0f;
+}
+
+Array SpatialHash::get_neighbors(const Vector3 &position, float radius, int layer_mask) const {
+    Array result;
+    for_each_neighbor(position, radius, static_cast<uint32_t>(layer_mask), [&](const Entry &entry, float) {
+        result.push_back(entry.node);
+    });
+    return result;
+}
+
+Node3D *SpatialHash::find_nearest(const Vector3 &position, float radius, int layer_mask, Node3D *exclude) const {
+    Node3D *nearest = nullptr;
+    float best = FLT_MAX;
+    for_each_neighbor(position, radius, static_cast<uint32_t>(layer_mask), [&](const Entry &entry, float distance_sq) {
+        if (entry.node != exclude && distance_sq < best) {
+            best = distance_sq;
+            nearest = entry.node;
+        }
+    });
+    return nearest;
+}
+
+void SpatialHash::set_cell_size(float size) {
+    cell_size = Math::clamp(size, 0.5f, 16.0f);
+}
+
+float SpatialHash::get_cell_size() const {
+    return cell_size;
+}
+
+float SpatialHash::get_last_rebuild_ms() const {
+    return last_rebuild_ms;
+}
+
+} // namespace rts
@@ -1136,6 +1136,10 @@ bool TerrainGenerator::is_within_bounds(float x, float z) const {
     return (x >= -half_world && x <= half_world && z >= -half_world && z <= half_world);
 }
 
+const PackedFloat32Array &TerrainGenerator::get_heightmap() const {
+    return heightmap;
+}
+
 // Setters and getters
 void TerrainGenerator::set_map_size(int size) {
     config.map_size = Math::clamp(size, 32, 512);
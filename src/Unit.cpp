@@ -1,22 +1,18 @@
 /**
  * Unit.cpp
- * RTS unit implementation with movement, selection, and flow field integration.
- * Includes collision avoidance for buildings, other units, and vehicles.
+ * RTS unit implementation with orders, selection, and flow field integration.
+ * Movement itself is stepped in batches by CrowdSystem.
  */
 
 #include "Unit.h"
+#include "CrowdSystem.h"
+#include "SpatialHash.h"
 
 #include <godot_cpp/classes/engine.hpp>
 #include <godot_cpp/classes/scene_tree.hpp>
 #include <godot_cpp/classes/window.hpp>
 #include <godot_cpp/classes/mesh_instance3d.hpp>
 #include <godot_cpp/classes/standard_material3d.hpp>
-#include <godot_cpp/classes/viewport.hpp>
-#include <godot_cpp/classes/world3d.hpp>
-#include <godot_cpp/classes/physics_direct_space_state3d.hpp>
-#include <godot_cpp/classes/physics_ray_query_parameters3d.hpp>
-#include <godot_cpp/classes/physics_shape_query_parameters3d.hpp>
-#include <godot_cpp/classes/sphere_shape3d.hpp>
 #include <godot_cpp/variant/utility_functions.hpp>
 
 using namespace godot;
@@ -28,6 +24,19 @@ void Unit::_bind_methods() {
     ClassDB::bind_method(D_METHOD("set_move_target", "target"), &Unit::set_move_target);
     ClassDB::bind_method(D_METHOD("apply_flow_vector", "vector"), &Unit::apply_flow_vector);
     ClassDB::bind_method(D_METHOD("stop_movement"), &Unit::stop_movement);
+    ClassDB::bind_method(D_METHOD("set_flow_field_id", "field_id"), &Unit::set_flow_field_id);
+    ClassDB::bind_method(D_METHOD("get_flow_field_id"), &Unit::get_flow_field_id);
+    
+    ClassDB::bind_method(D_METHOD("queue_move_target", "target", "field_id"), &Unit::queue_move_target, DEFVAL(-1));
+    ClassDB::bind_method(D_METHOD("clear_waypoints"), &Unit::clear_waypoints);
+    ClassDB::bind_method(D_METHOD("get_waypoint_count"), &Unit::get_waypoint_count);
+    ClassDB::bind_method(D_METHOD("get_waypoints"), &Unit::get_waypoints);
+    ClassDB::bind_method(D_METHOD("get_final_target"), &Unit::get_final_target);
+    
+    ClassDB::bind_method(D_METHOD("set_path", "points", "version"), &Unit::set_path);
+    ClassDB::bind_method(D_METHOD("clear_path"), &Unit::clear_path);
+    ClassDB::bind_method(D_METHOD("is_following_path"), &Unit::is_following_path);
+    ClassDB::bind_method(D_METHOD("get_path_points"), &Unit::get_path_points);
     
     ClassDB::bind_method(D_METHOD("set_selected", "selected"), &Unit::set_selected);
     ClassDB::bind_method(D_METHOD("get_selected"), &Unit::get_selected);
@@ -36,6 +45,7 @@ void Unit::_bind_methods() {
     ClassDB::bind_method(D_METHOD("get_hovered"), &Unit::get_hovered);
     
     ClassDB::bind_method(D_METHOD("is_moving"), &Unit::is_moving);
+    ClassDB::bind_method(D_METHOD("get_has_move_order"), &Unit::get_has_move_order);
     ClassDB::bind_method(D_METHOD("get_target_position"), &Unit::get_target_position);
     
     // Properties
@@ -67,10 +77,15 @@ void Unit::_bind_methods() {
     ClassDB::bind_method(D_METHOD("get_attack_range"), &Unit::get_attack_range);
     ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "attack_range"), "set_attack_range", "get_attack_range");
     
+    ClassDB::bind_method(D_METHOD("set_patrol", "enabled"), &Unit::set_patrol);
+    ClassDB::bind_method(D_METHOD("get_patrol"), &Unit::get_patrol);
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "patrol"), "set_patrol", "get_patrol");
+    
     // Signals
     ADD_SIGNAL(MethodInfo("unit_selected", PropertyInfo(Variant::OBJECT, "unit")));
     ADD_SIGNAL(MethodInfo("unit_deselected", PropertyInfo(Variant::OBJECT, "unit")));
     ADD_SIGNAL(MethodInfo("unit_arrived", PropertyInfo(Variant::OBJECT, "unit")));
+    ADD_SIGNAL(MethodInfo("waypoint_reached", PropertyInfo(Variant::OBJECT, "unit"), PropertyInfo(Variant::VECTOR3, "waypoint")));
     ADD_SIGNAL(MethodInfo("unit_hovered", PropertyInfo(Variant::OBJECT, "unit")));
     ADD_SIGNAL(MethodInfo("unit_unhovered", PropertyInfo(Variant::OBJECT, "unit")));
 }
@@ -81,248 +96,257 @@ Unit::Unit() {
 Unit::~Unit() {
 }
 
-void Unit::_ready() {
+void Unit::_enter_tree() {
     if (Engine::get_singleton()->is_editor_hint()) {
         return;
     }
     
-    target_position = get_global_position();
-    current_velocity = Vector3(0, 0, 0);
-    flow_vector = Vector3(0, 0, 0);
-    last_position = get_global_position();
-    
-    // Store the base speed and Y offset for walking animation
-    base_move_speed = move_speed;
-    base_y_offset = 0.0f;
-    terrain_height = get_global_position().y;
-    last_terrain_height = terrain_height;
-    
-    // Cache terrain generator reference for performance
+    // Join the shared crowd and spatial hash on every entry, since _exit_tree leaves them
+    // and _ready only runs once
     SceneTree *tree = get_tree();
     if (tree) {
         Node *root = tree->get_root();
         if (root) {
-            cached_terrain_generator = root->find_child("TerrainGenerator", true, false);
+            crowd = Object::cast_to<CrowdSystem>(root->find_child("CrowdSystem", true, false));
+            cached_spatial_hash = Object::cast_to<SpatialHash>(root->find_child("SpatialHash", true, false));
         }
     }
-    
-    // Initialize cached physics shapes for separation/avoidance (avoid per-frame allocations)
-    cached_separation_sphere.instantiate();
-    cached_separation_sphere->set_radius(separation_radius);
-    
-    cached_shape_query.instantiate();
-    cached_shape_query->set_shape(cached_separation_sphere);
-    cached_shape_query->set_collision_mask(2 | 8); // Units and vehicles
-    
-    cached_ray_query.instantiate();
-    cached_ray_query->set_collision_mask(obstacle_mask);
+    if (crowd) {
+        crowd_index = crowd->add_agent(this);
+    } else {
+        UtilityFunctions::print("Unit: No CrowdSystem in scene, unit will not move");
+    }
+    if (cached_spatial_hash) {
+        cached_spatial_hash->register_entity(this, SPATIAL_LAYER_UNITS);
+    }
+}
+
+void Unit::_ready() {
+    if (Engine::get_singleton()->is_editor_hint()) {
+        return;
+    }
     
     // Set collision layer to 2 (units)
+    // Bodies are positioned by CrowdSystem; shapes remain for picking and vehicle contacts
     set_collision_layer(2);
-    // Collide with ground (1) and buildings (4) - physical collision prevents passing through
-    // Also collide with other units (2) and vehicles (8) for physical blocking
     set_collision_mask(1 | 2 | 4 | 8);
-    
-    // Configure CharacterBody3D for proper slope handling
-    // Allow walking on slopes up to 60 degrees (mountains can be steep)
-    set_floor_max_angle(Math::deg_to_rad(60.0f));
-    // Ensure we snap to floor when walking
-    set_floor_snap_length(1.0f);
-    // Set up direction for floor detection
-    set_up_direction(Vector3(0, 1, 0));
-    // Allow sliding on walls/slopes
-    set_slide_on_ceiling_enabled(false);
-    // Maximum slope for floor detection
-    set_floor_stop_on_slope_enabled(false);
-    set_floor_block_on_wall_enabled(false);
-}
-
-void Unit::_physics_process(double delta) {
-    if (Engine::get_singleton()->is_editor_hint()) {
-        return;
+}
+
+void Unit::_exit_tree() {
+    if (crowd) {
+        crowd->remove_agent(crowd_index);
+        crowd = nullptr;
+        crowd_index = -1;
+    }
+    if (cached_spatial_hash) {
+        cached_spatial_hash->unregister_entity(this);
+        cached_spatial_hash = nullptr;
     }
-    
-    update_movement(delta);
-    update_walk_animation(delta);
 }
 
 void Unit::set_move_target(const Vector3 &target) {
-    target_position = target;
+    if (!crowd) return;
+    
+    Vector3 target_position = target;
     target_position.y = get_global_position().y; // Keep same height
-    has_move_order = true;
+    crowd->set_agent_target(crowd_index, target_position);
+    crowd->set_agent_has_order(crowd_index, true);
+    
+    // Field for the previous target no longer applies, and a plain order replaces the queue
+    flow_field_id = -1;
+    crowd->set_agent_flow_vector(crowd_index, Vector3(0, 0, 0));
+    waypoints.clear();
+    clear_path();
 }
 
 void Unit::apply_flow_vector(const Vector3 &vector) {
-    flow_vector = vector;
+    if (crowd) {
+        crowd->set_agent_flow_vector(crowd_index, vector);
+    }
 }
 
 void Unit::stop_movement() {
-    has_move_order = false;
-    flow_vector = Vector3(0, 0, 0);
-    current_velocity = Vector3(0, 0, 0);
-}
-
-void Unit::update_movement(double delta) {
-    if (!has_move_order) {
-        // Decelerate to stop
-        if (current_velocity.length_squared() > 0.01f) {
-            current_velocity = current_velocity.move_toward(Vector3(0, 0, 0), deceleration * delta);
-            set_velocity(current_velocity);
-            move_and_slide();
-        }
-        is_avoiding = false;
-        return;
+    flow_field_id = -1;
+    if (crowd) {
+        crowd->set_agent_has_order(crowd_index, false);
+        crowd->set_agent_flow_vector(crowd_index, Vector3(0, 0, 0));
+        crowd->set_agent_velocity(crowd_index, Vector3(0, 0, 0));
     }
-    
-    Vector3 current_pos = get_global_position();
-    Vector3 to_target = target_position - current_pos;
-    to_target.y = 0;
-    
-    float distance = to_target.length();
-    
-    // Check if arrived
-    if (distance < arrival_threshold) {
-        has_move_order = false;
-        current_velocity = Vector3(0, 0, 0);
-        is_avoiding = false;
-        emit_signal("unit_arrived", this);
+    waypoints.clear();
+    clear_path();
+}
+
+void Unit::set_flow_field_id(int field_id) {
+    flow_field_id = field_id;
+}
+
+int Unit::get_flow_field_id() const {
+    return flow_field_id;
+}
+
+void Unit::queue_move_target(const Vector3 &target, int field_id) {
+    // Nothing to queue behind, so this is the current leg
+    if (!get_has_move_order()) {
+        set_move_target(target);
+        flow_field_id = field_id;
         return;
     }
     
-    // Update stuck detection
-    update_stuck_detection(delta);
-    
-    // Calculate base desired direction toward target
-    Vector3 desired_direction = to_target.normalized();
-    
-    // Use flow field if available
-    if (use_flow_field && flow_vector.length_squared() > 0.01f) {
-        desired_direction = flow_vector.normalized();
+    Waypoint waypoint;
+    waypoint.position = target;
+    waypoint.position.y = get_global_position().y;
+    waypoint.field_id = field_id;
+    waypoints.push_back(waypoint);
+}
+
+void Unit::clear_waypoints() {
+    waypoints.clear();
+}
+
+bool Unit::advance_waypoint() {
+    if (waypoints.empty() || !crowd) {
+        return false;
     }
     
-    // Check if path ahead is blocked
-    float forward_distance = raycast_distance(desired_direction, avoidance_radius);
-    bool path_blocked = forward_distance < avoidance_radius * 0.8f;
-    
-    Vector3 move_direction = desired_direction;
-    
-    if (path_blocked) {
-        // Find a clear direction to go around the obstacle
-        move_direction = find_clear_direction(desired_direction);
-        is_avoiding = true;
-    } else {
-        // Path is clear, but check if we were avoiding and should continue
-        if (is_avoiding) {
-            // Check if the direct path to target is now clear
-            Vector3 direct_to_target = to_target.normalized();
-            float direct_distance = raycast_distance(direct_to_target, avoidance_radius);
-            if (direct_distance >= avoidance_radius * 0.9f) {
-                is_avoiding = false;
-            } else {
-                // Continue with avoidance direction
-                move_direction = find_clear_direction(desired_direction);
-            }
-        }
+    // Patrols keep the finished leg and its field for the next lap
+    Vector3 reached = crowd->get_agent_target(crowd_index);
+    if (patrol) {
+        Waypoint lap;
+        lap.position = reached;
+        lap.field_id = flow_field_id;
+        waypoints.push_back(lap);
     }
     
-    // Add separation from other units
-    Vector3 separation = calculate_separation_force();
-    move_direction = (move_direction + separation * 0.3f).normalized();
+    crowd->set_agent_target(crowd_index, waypoints.front().position);
+    crowd->set_agent_flow_vector(crowd_index, Vector3(0, 0, 0));
+    flow_field_id = waypoints.front().field_id;
+    waypoints.pop_front();
     
-    // Calculate desired velocity
-    Vector3 desired_velocity = move_direction * move_speed;
+    // Path units stay on paths; the next leg is planned by UnitSpawner
+    path_points.clear();
+    path_index = 0;
+    path_version = -1;
     
-    // Apply steering
-    Vector3 steering = calculate_steering(desired_velocity);
-    current_velocity += steering * delta;
-    
-    // Clamp to max speed
-    if (current_velocity.length() > move_speed) {
-        current_velocity = current_velocity.normalized() * move_speed;
+    emit_signal("waypoint_reached", this, reached);
+    return true;
+}
+
+int Unit::get_waypoint_count() const {
+    return static_cast<int>(waypoints.size());
+}
+
+Vector3 Unit::get_waypoint(int index) const {
+    return waypoints[index].position;
+}
+
+PackedVector3Array Unit::get_waypoints() const {
+    PackedVector3Array result;
+    for (const Waypoint &waypoint : waypoints) {
+        result.push_back(waypoint.position);
     }
+    return result;
+}
+
+int Unit::get_waypoint_field_id(int index) const {
+    return waypoints[index].field_id;
+}
+
+void Unit::set_waypoint_field_id(int index, int field_id) {
+    waypoints[index].field_id = field_id;
+}
+
+Vector3 Unit::get_final_target() const {
+    return waypoints.empty() ? get_target_position() : waypoints.back().position;
+}
+
+void Unit::set_patrol(bool enabled) {
+    patrol = enabled;
+}
+
+bool Unit::get_patrol() const {
+    return patrol;
+}
+
+void Unit::set_path(const PackedVector3Array &points, int version) {
+    use_path = true;
+    path_points = points;
+    path_index = 0;
+    path_version = version;
     
-    // Apply movement
-    set_velocity(current_velocity);
-    move_and_slide();
-    
-    // Snap to terrain height
-    snap_to_terrain();
-    
-    // Rotate to face movement direction
-    if (current_velocity.length_squared() > 0.1f) {
-        Vector3 look_dir = current_velocity.normalized();
-        float target_angle = Math::atan2(look_dir.x, look_dir.z);
-        Vector3 rotation = get_rotation();
-        rotation.y = Math::lerp_angle(rotation.y, target_angle, static_cast<float>(steering_strength * delta));
-        set_rotation(rotation);
-    }
+    // The path replaces any field for this leg
+    flow_field_id = -1;
+    apply_flow_vector(Vector3(0, 0, 0));
 }
 
-void Unit::update_walk_animation(double delta) {
-    // Get the mesh instance for animation
-    MeshInstance3D *mesh = nullptr;
-    for (int i = 0; i < get_child_count(); i++) {
-        mesh = Object::cast_to<MeshInstance3D>(get_child(i));
-        if (mesh) break;
+void Unit::clear_path() {
+    use_path = false;
+    path_points.clear();
+    path_index = 0;
+    path_version = -1;
+}
+
+bool Unit::is_following_path() const {
+    return use_path && get_has_move_order();
+}
+
+int Unit::get_path_version() const {
+    return path_version;
+}
+
+PackedVector3Array Unit::get_path_points() const {
+    return path_points;
+}
+
+bool Unit::steer_along_path(const Vector3 &position, Vector3 &direction) {
+    if (!use_path || path_index >= path_points.size()) {
+        return false;
     }
     
-    if (!mesh) return;
-    
-    float speed = current_velocity.length();
-    
-    if (speed > 0.5f) {
-        // Animate walk - increase time based on speed
-        walk_time += delta * walk_bob_speed * (speed / move_speed);
-        
-        // Vertical bobbing (two steps per cycle)
-        float bob_y = Math::sin(walk_time * 2.0f) * walk_bob_amount * (speed / move_speed);
-        
-        // Side-to-side sway
-        float sway_x = Math::sin(walk_time) * walk_sway_amount * (speed / move_speed);
-        
-        // Slight forward/backward lean based on acceleration
-        float lean = 0.0f;
-        if (has_move_order) {
-            lean = 0.05f; // Slight forward lean when moving
-        }
-        
-        // Apply to mesh position (relative to unit)
-        Vector3 mesh_pos = mesh->get_position();
-        mesh_pos.y = 0.5f + bob_y; // Base offset + bob (0.5 is the original offset in the scene)
-        mesh_pos.x = sway_x;
-        mesh->set_position(mesh_pos);
-        
-        // Apply slight rotation for walking feel
-        Vector3 mesh_rot = mesh->get_rotation();
-        mesh_rot.x = lean;
-        mesh_rot.z = -sway_x * 2.0f; // Tilt based on sway
-        mesh->set_rotation(mesh_rot);
-    } else {
-        // Reset to idle position smoothly
-        walk_time = 0.0f;
-        
-        Vector3 mesh_pos = mesh->get_position();
-        mesh_pos.y = Math::lerp(mesh_pos.y, 0.5f, static_cast<float>(delta * 10.0f));
-        mesh_pos.x = Math::lerp(mesh_pos.x, 0.0f, static_cast<float>(delta * 10.0f));
-        mesh->set_position(mesh_pos);
-        
-        Vector3 mesh_rot = mesh->get_rotation();
-        mesh_rot.x = Math::lerp(mesh_rot.x, 0.0f, static_cast<float>(delta * 10.0f));
-        mesh_rot.z = Math::lerp(mesh_rot.z, 0.0f, static_cast<float>(delta * 10.0f));
-        mesh->set_rotation(mesh_rot);
+    // Steer at the current path point, moving on once it is close; read through a const
+    // reference so worker threads never trigger a copy-on-write
+    const PackedVector3Array &points = path_points;
+    Vector3 to_point = points[path_index] - position;
+    to_point.y = 0;
+    while (path_index < points.size() - 1 && to_point.length() < path_point_radius) {
+        path_index++;
+        to_point = points[path_index] - position;
+        to_point.y = 0;
+    }
+    if (to_point.length_squared() <= 0.0001f) {
+        return false;
     }
+    
+    direction = to_point.normalized();
+    return true;
 }
 
-Vector3 Unit::calculate_steering(const Vector3 &desired_velocity) const {
-    Vector3 steering = desired_velocity - current_velocity;
+int Unit::get_path_index() const {
+    return path_index;
+}
+
+void Unit::set_path_index(int index) {
+    path_index = index;
+}
+
+void Unit::on_target_reached() {
+    if (!crowd) return;
     
-    // Limit steering force
-    float max_steering = acceleration;
-    if (steering.length() > max_steering) {
-        steering = steering.normalized() * max_steering;
+    // A queued waypoint takes over without stopping
+    if (advance_waypoint()) {
+        return;
     }
     
-    return steering;
+    crowd->set_agent_has_order(crowd_index, false);
+    crowd->set_agent_velocity(crowd_index, Vector3(0, 0, 0));
+    emit_signal("unit_arrived", this);
+}
+
+void Unit::set_crowd_index(int index) {
+    crowd_index = index;
+}
+
+int Unit::get_crowd_index() const {
+    return crowd_index;
 }
 
 void Unit::set_selected(bool selected) {
@@ -425,6 +449,9 @@ void Unit::update_hover_visual() {
 
 void Unit::set_move_speed(float speed) {
     move_speed = speed;
+    if (crowd) {
+        crowd->set_agent_base_speed(crowd_index, speed);
+    }
 }
 
 float Unit::get_move_speed() const {
@@ -440,11 +467,15 @@ int Unit::get_unit_id() const {
 }
 
 bool Unit::is_moving() const {
-    return has_move_order || current_velocity.length_squared() > 0.1f;
+    return crowd && (crowd->get_agent_has_order(crowd_index) || crowd->get_agent_velocity(crowd_index).length_squared() > 0.1f);
+}
+
+bool Unit::get_has_move_order() const {
+    return crowd && crowd->get_agent_has_order(crowd_index);
 }
 
 Vector3 Unit::get_target_position() const {
-    return target_position;
+    return crowd ? crowd->get_agent_target(crowd_index) : get_global_position();
 }
 
 void Unit::set_unit_name(const String &name) {
@@ -487,260 +518,4 @@ float Unit::get_attack_range() const {
     return attack_range;
 }
 
-Vector3 Unit::calculate_avoidance_force() {
-    // This is now a simpler force-based backup, main avoidance is in find_clear_direction
-    Vector3 avoidance_force = Vector3(0, 0, 0);
-    
-    Ref<World3D> world = get_viewport()->get_world_3d();
-    if (world.is_null()) return avoidance_force;
-    
-    PhysicsDirectSpaceState3D *space_state = world->get_direct_space_state();
-    if (!space_state) return avoidance_force;
-    
-    Vector3 current_pos = get_global_position();
-    Vector3 forward = current_velocity.normalized();
-    if (forward.length_squared() < 0.01f) {
-        forward = -get_transform().basis.get_column(2);
-    }
-    
-    // Simple forward check for immediate obstacles
-    float ahead_dist = raycast_distance(forward, wall_follow_distance);
-    if (ahead_dist < wall_follow_distance) {
-        // Push away from the obstacle
-        float strength = (1.0f - ahead_dist / wall_follow_distance) * avoidance_strength;
-        avoidance_force = -forward * strength;
-    }
-    
-    return avoidance_force;
-}
-
-Vector3 Unit::calculate_separation_force() {
-    Vector3 separation_force = Vector3(0, 0, 0);
-    
-    Ref<World3D> world = get_viewport()->get_world_3d();
-    if (world.is_null()) return separation_force;
-    
-    PhysicsDirectSpaceState3D *space_state = world->get_direct_space_state();
-    if (!space_state) return separation_force;
-    
-    if (cached_shape_query.is_null()) return separation_force;
-    
-    Vector3 current_pos = get_global_position();
-    
-    // Use cached shape query (shapes initialized in _ready)
-    cached_shape_query->set_transform(Transform3D(Basis(), current_pos + Vector3(0, 0.5f, 0)));
-    cached_shape_query->set_exclude(TypedArray<RID>::make(get_rid()));
-    
-    TypedArray<Dictionary> results = space_state->intersect_shape(cached_shape_query, 10);
-    
-    for (int i = 0; i < results.size(); i++) {
-        Dictionary result = results[i];
-        Object *collider_obj = Object::cast_to<Object>(result["collider"]);
-        if (!collider_obj) continue;
-        
-        Node3D *other = Object::cast_to<Node3D>(collider_obj);
-        if (!other || other == this) continue;
-        
-        Vector3 other_pos = other->get_global_position();
-        Vector3 away = current_pos - other_pos;
-        away.y = 0;
-        
-        float dist = away.length();
-        if (dist > 0.01f && dist < separation_radius) {
-            float strength = (1.0f - dist / separation_radius) * separation_strength;
-            separation_force += away.normalized() * strength;
-        }
-    }
-    
-    return separation_force;
-}
-
-Vector3 Unit::find_clear_direction(const Vector3 &preferred_dir) {
-    // Context steering: cast rays in multiple directions and find the best open path
-    // Reduced from 16 to 8 directions for performance
-    const int num_directions = 8;
-    float best_score = -1000.0f;
-    Vector3 best_direction = preferred_dir;
-    
-    Vector3 current_pos = get_global_position();
-    Vector3 to_target = (target_position - current_pos).normalized();
-    
-    for (int i = 0; i < num_directions; i++) {
-        float angle = (i * 2.0f * Math_PI) / num_directions;
-        Vector3 dir = Vector3(Math::sin(angle), 0, Math::cos(angle));
-        
-        // Raycast in this direction
-        float clearance = raycast_distance(dir, avoidance_radius);
-        
-        // Score this direction
-        // Higher clearance is better
-        float clearance_score = clearance / avoidance_radius;
-        
-        // Prefer directions toward the target
-        float target_alignment = dir.dot(to_target);
-        float target_score = (target_alignment + 1.0f) * 0.5f; // 0 to 1
-        
-        // Prefer directions aligned with preferred direction (momentum)
-        float momentum_alignment = dir.dot(preferred_dir);
-        float momentum_score = (momentum_alignment + 1.0f) * 0.25f; // 0 to 0.5
-        
-        // Combined score - clearance is most important, then target direction
-        float score = clearance_score * 2.0f + target_score * 1.5f + momentum_score;
-        
-        // If path is blocked, heavily penalize
-        if (clearance < 1.0f) {
-            score -= 5.0f;
-        }
-        
-        if (score > best_score) {
-            best_score = score;
-            best_direction = dir;
-        }
-    }
-    
-    // If we found a clear direction, remember which side we're going around
-    if (best_direction.cross(preferred_dir).y > 0) {
-        avoid_direction = 1.0f; // Going right
-    } else {
-        avoid_direction = -1.0f; // Going left
-    }
-    
-    return best_direction;
-}
-
-float Unit::raycast_distance(const Vector3 &direction, float max_distance) {
-    Ref<World3D> world = get_viewport()->get_world_3d();
-    if (world.is_null()) return max_distance;
-    
-    PhysicsDirectSpaceState3D *space_state = world->get_direct_space_state();
-    if (!space_state) return max_distance;
-    
-    Vector3 current_pos = get_global_position();
-    Vector3 from = current_pos + Vector3(0, 0.5f, 0);
-    Vector3 to = from + direction.normalized() * max_distance;
-    
-    // Use cached ray query when possible, but we need to create new for different rays
-    // PhysicsRayQueryParameters3D::create is still needed as rays change per-call
-    Ref<PhysicsRayQueryParameters3D> query = PhysicsRayQueryParameters3D::create(from, to);
-    query->set_collision_mask(obstacle_mask); // Buildings only for pathfinding
-    query->set_exclude(TypedArray<RID>::make(get_rid()));
-    
-    Dictionary result = space_state->intersect_ray(query);
-    
-    if (result.is_empty()) {
-        return max_distance;
-    }
-    
-    Vector3 hit_pos = result["position"];
-    return (hit_pos - from).length();
-}
-
-bool Unit::check_path_blocked(const Vector3 &direction, float distance) {
-    return raycast_distance(direction, distance) < distance;
-}
-
-void Unit::update_stuck_detection(double delta) {
-    Vector3 current_pos = get_global_position();
-    float moved_distance = (current_pos - last_position).length();
-    
-    if (moved_distance < 0.05f * delta) {
-        stuck_timer += delta;
-        if (stuck_timer > 1.0f) {
-            // We're stuck, try a different avoidance direction
-            avoid_direction = -avoid_direction;
-            stuck_timer = 0.0f;
-        }
-    } else {
-        stuck_timer = 0.0f;
-    }
-    
-    last_position = current_pos;
-}
-
-void Unit::snap_to_terrain() {
-    // Use cached terrain generator reference (cached in _ready for performance)
-    if (!cached_terrain_generator) return;
-    
-    Vector3 pos = get_global_position();
-    
-    // Check if within bounds
-    Variant bounds_result = cached_terrain_generator->call("is_within_bounds", pos.x, pos.z);
-    if (bounds_result.get_type() == Variant::BOOL && !(bool)bounds_result) {
-        // Out of bounds - push back toward center
-        float world_size = 0.0f;
-        Variant size_result = cached_terrain_generator->call("get_world_size");
-        if (size_result.get_type() == Variant::FLOAT) {
-            world_size = (float)size_result * 0.5f - 5.0f; // 5 unit buffer from edge
-        } else {
-            world_size = 100.0f; // Fallback
-        }
-        
-        pos.x = Math::clamp(pos.x, -world_size, world_size);
-        pos.z = Math::clamp(pos.z, -world_size, world_size);
-    }
-    
-    // Get terrain height at current position
-    Variant height_result = cached_terrain_generator->call("get_height_at", pos.x, pos.z);
-    if (height_result.get_type() == Variant::FLOAT || height_result.get_type() == Variant::INT) {
-        last_terrain_height = terrain_height;
-        terrain_height = (float)height_result;
-        pos.y = terrain_height;
-        set_global_position(pos);
-        
-        // Calculate slope based on height change and horizontal movement
-        float horizontal_speed = Vector2(current_velocity.x, current_velocity.z).length();
-        if (horizontal_speed > 0.1f) {
-            float height_diff = terrain_height - last_terrain_height;
-            // Normalize slope: positive = going uphill, negative = going downhill
-            current_slope = Math::clamp(height_diff / (horizontal_speed * 0.016f), -1.0f, 1.0f);
-            
-            // Adjust move speed based on slope
-            if (current_slope > 0.05f) {
-                // Going uphill - slow down
-                float slope_factor = 1.0f - (current_slope * (1.0f - uphill_speed_multiplier));
-                move_speed = base_move_speed * Math::max(slope_factor, uphill_speed_multiplier);
-            } else if (current_slope < -0.05f) {
-                // Going downhill - speed up
-                float slope_factor = 1.0f + (-current_slope * (downhill_speed_multiplier - 1.0f));
-                move_speed = base_move_speed * Math::min(slope_factor, downhill_speed_multiplier);
-            } else {
-                // Flat terrain - normal speed
-                move_speed = base_move_speed;
-            }
-        }
-    }
-}
-
-float Unit::get_slope_ahead(const Vector3 &direction, float check_distance) {
-    // Check the terrain slope in the given direction
-    if (!cached_terrain_generator) return 0.0f;
-    
-    Vector3 current_pos = get_global_position();
-    Vector3 ahead_pos = current_pos + direction.normalized() * check_distance;
-    
-    // Get heights at both positions
-    Variant current_height = cached_terrain_generator->call("get_height_at", current_pos.x, current_pos.z);
-    Variant ahead_height = cached_terrain_generator->call("get_height_at", ahead_pos.x, ahead_pos.z);
-    
-    if ((current_height.get_type() == Variant::FLOAT || current_height.get_type() == Variant::INT) &&
-        (ahead_height.get_type() == Variant::FLOAT || ahead_height.get_type() == Variant::INT)) {
-        float h1 = (float)current_height;
-        float h2 = (float)ahead_height;
-        float height_diff = h2 - h1;
-        
-        // Calculate slope as rise/run (tangent of angle)
-        // Positive = uphill, negative = downhill
-        return height_diff / check_distance;
-    }
-    
-    return 0.0f;
-}
-
-bool Unit::can_traverse_slope(const Vector3 &direction) {
-    float slope = get_slope_ahead(direction, 2.0f);
-    // Check if slope is within traversable range
-    // slope is rise/run, so 1.0 = 45 degrees, 0.7 = ~35 degrees
-    return Math::abs(slope) <= max_traversable_slope;
-}
-
 } // namespace rts
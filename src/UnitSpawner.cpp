@@ -25,6 +25,9 @@
 #include <godot_cpp/classes/physics_shape_query_parameters3d.hpp>
 #include <godot_cpp/variant/utility_functions.hpp>
 
+#include <unordered_map>
+#include <vector>
+
 using namespace godot;
 
 namespace rts {
@@ -45,7 +48,7 @@ void UnitSpawner::_bind_methods() {
     // Properties
     ClassDB::bind_method(D_METHOD("set_max_units", "count"), &UnitSpawner::set_max_units);
     ClassDB::bind_method(D_METHOD("get_max_units"), &UnitSpawner::get_max_units);
-    ADD_PROPERTY(PropertyInfo(Variant::INT, "max_units", PROPERTY_HINT_RANGE, "10,500,10"), "set_max_units", "get_max_units");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "max_units", PROPERTY_HINT_RANGE, "10,10000,10"), "set_max_units", "get_max_units");
     
     ClassDB::bind_method(D_METHOD("set_auto_spawn", "enabled"), &UnitSpawner::set_auto_spawn);
     ClassDB::bind_method(D_METHOD("get_auto_spawn"), &UnitSpawner::get_auto_spawn);
@@ -85,7 +88,8 @@ void UnitSpawner::_process(double delta) {
         return;
     }
     
-    // Update flow vectors for all units
+    // Feed the congestion layer, then update flow vectors for all units
+    update_unit_density();
     update_units_flow_vectors();
     
     // Sync unit transforms to MultiMesh
@@ -305,17 +309,94 @@ int UnitSpawner::get_unit_count() const {
     return units.size();
 }
 
+void UnitSpawner::update_unit_density() {
+    if (!flow_field_manager || !flow_field_manager->is_density_update_due()) {
+        return;
+    }
+    
+    // Idle units block chokepoints as much as moving ones, so every unit is counted
+    PackedVector3Array positions;
+    positions.resize(units.size());
+    int count = 0;
+    for (int i = 0; i < units.size(); i++) {
+        if (units[i]) {
+            positions.set(count++, units[i]->get_global_position());
+        }
+    }
+    positions.resize(count);
+    
+    flow_field_manager->update_density(positions);
+}
+
 void UnitSpawner::update_units_flow_vectors() {
-    if (!flow_field_manager || !flow_field_manager->is_field_valid()) {
+    if (!flow_field_manager) {
         return;
     }
     
+    // Group moving units by field so each field is sampled in one batched call
+    std::unordered_map<int, std::vector<Unit *>> units_by_field;
+    std::unordered_map<int, PackedVector3Array> positions_by_field;
+    
     for (int i = 0; i < units.size(); i++) {
         Unit *unit = units[i];
-        if (unit && unit->is_moving()) {
-            Vector3 flow = flow_field_manager->get_flow_direction(unit->get_global_position());
-            unit->apply_flow_vector(flow);
+        if (unit && unit->get_has_move_order()) {
+            Vector3 unit_pos = unit->get_global_position();
+            
+            // Path units steer on their own points; replan after walkability changes or a new
+            // leg, and fall back to a field if the target is no longer reachable by A*
+            if (unit->is_following_path()) {
+                int version = flow_field_manager->get_walkability_version();
+                if (unit->get_path_version() == version) {
+                    continue;
+                }
+                PackedVector3Array path = flow_field_manager->find_path(unit_pos, unit->get_target_position());
+                if (!path.is_empty()) {
+                    unit->set_path(path, version);
+                    continue;
+                }
+                unit->clear_path();
+            }
+            
+            // Each unit steers on the field for its own target; re-request it if it
+            // was never assigned, has been evicted, or the unit left its corridor
+            int field_id = unit->get_flow_field_id();
+            if (!flow_field_manager->field_covers_position(field_id, unit_pos)) {
+                PackedVector3Array start_positions;
+                start_positions.push_back(unit_pos);
+                field_id = flow_field_manager->request_flow_field(unit->get_target_position(), start_positions);
+                unit->set_flow_field_id(field_id);
+            }
+            
+            units_by_field[field_id].push_back(unit);
+            positions_by_field[field_id].push_back(unit_pos);
+            
+            if (unit->get_waypoint_count() > 0) {
+                prefetch_waypoint_fields(unit);
+            }
+        }
+    }
+    
+    for (auto &entry : units_by_field) {
+        PackedVector3Array flows = flow_field_manager->get_flow_directions(entry.first, positions_by_field[entry.first]);
+        const std::vector<Unit *> &field_units = entry.second;
+        for (size_t i = 0; i < field_units.size(); i++) {
+            field_units[i]->apply_flow_vector(flows[i]);
+        }
+    }
+}
+
+void UnitSpawner::prefetch_waypoint_fields(Unit *unit) {
+    // Each leg starts where the previous one ends; fields build in the background while
+    // the unit is still on an earlier leg, and evicted ones are simply requested again
+    Vector3 leg_start = unit->get_target_position();
+    for (int i = 0; i < unit->get_waypoint_count(); i++) {
+        Vector3 waypoint = unit->get_waypoint(i);
+        if (!flow_field_manager->has_flow_field(unit->get_waypoint_field_id(i))) {
+            PackedVector3Array start_positions;
+            start_positions.push_back(leg_start);
+            unit->set_waypoint_field_id(i, flow_field_manager->request_flow_field(waypoint, start_positions));
         }
+        leg_start = waypoint;
     }
 }
 
@@ -6,6 +6,8 @@
 
 #include "Vehicle.h"
 #include "FloorSnapper.h"
+#include "FlowFieldManager.h"
+#include "SpatialHash.h"
 
 #include <godot_cpp/classes/engine.hpp>
 #include <godot_cpp/classes/scene_tree.hpp>
@@ -67,6 +69,14 @@ void Vehicle::_bind_methods() {
     ClassDB::bind_method(D_METHOD("get_model_scale"), &Vehicle::get_model_scale);
     ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "model_scale", PROPERTY_HINT_RANGE, "0.01,10.0,0.01"), "set_model_scale", "get_model_scale");
     
+    ClassDB::bind_method(D_METHOD("set_footprint_class", "footprint_class"), &Vehicle::set_footprint_class);
+    ClassDB::bind_method(D_METHOD("get_footprint_class"), &Vehicle::get_footprint_class);
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "footprint_class", PROPERTY_HINT_ENUM, "Infantry,Light Vehicle,Heavy Vehicle"), "set_footprint_class", "get_footprint_class");
+    
+    ClassDB::bind_method(D_METHOD("set_flow_lookahead_scale", "scale"), &Vehicle::set_flow_lookahead_scale);
+    ClassDB::bind_method(D_METHOD("get_flow_lookahead_scale"), &Vehicle::get_flow_lookahead_scale);
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "flow_lookahead_scale", PROPERTY_HINT_RANGE, "0.0,4.0,0.1"), "set_flow_lookahead_scale", "get_flow_lookahead_scale");
+    
     // Signals
     ADD_SIGNAL(MethodInfo("vehicle_selected", PropertyInfo(Variant::OBJECT, "vehicle")));
     ADD_SIGNAL(MethodInfo("vehicle_deselected", PropertyInfo(Variant::OBJECT, "vehicle")));
@@ -78,6 +88,21 @@ Vehicle::Vehicle() {
 Vehicle::~Vehicle() {
 }
 
+void Vehicle::_enter_tree() {
+    if (Engine::get_singleton()->is_editor_hint()) {
+        return;
+    }
+    
+    // Registered on every entry to pair with _exit_tree; _ready only runs once
+    SceneTree *tree = get_tree();
+    if (tree && tree->get_root()) {
+        cached_spatial_hash = Object::cast_to<SpatialHash>(tree->get_root()->find_child("SpatialHash", true, false));
+    }
+    if (cached_spatial_hash) {
+        cached_spatial_hash->register_entity(this, SPATIAL_LAYER_VEHICLES);
+    }
+}
+
 void Vehicle::_ready() {
     if (Engine::get_singleton()->is_editor_hint()) {
         return;
@@ -117,6 +142,7 @@ void Vehicle::_ready() {
         Node *root = tree->get_root();
         if (root) {
             cached_terrain_generator = root->find_child("TerrainGenerator", true, false);
+            cached_flow_field_manager = Object::cast_to<FlowFieldManager>(root->find_child("FlowFieldManager", true, false));
         }
     }
     
@@ -152,6 +178,13 @@ void Vehicle::_ready() {
     }
 }
 
+void Vehicle::_exit_tree() {
+    if (cached_spatial_hash) {
+        cached_spatial_hash->unregister_entity(this);
+        cached_spatial_hash = nullptr;
+    }
+}
+
 void Vehicle::_process(double delta) {
     if (Engine::get_singleton()->is_editor_hint()) {
         return;
@@ -186,22 +219,49 @@ void Vehicle::_physics_process(double delta) {
     
     direction = direction.normalized();
     
-    // Check if path ahead is blocked
-    float forward_distance = raycast_distance(direction, avoidance_radius);
-    bool path_blocked = forward_distance < avoidance_radius * 0.7f;
+    // Follow the field for this vehicle's footprint class; re-request it if it was
+    // evicted or the vehicle left its corridor, and steer straight while it is building
+    bool following_field = false;
+    if (cached_flow_field_manager && flow_field_id != -1) {
+        if (!cached_flow_field_manager->field_covers_position(flow_field_id, current_pos)) {
+            PackedVector3Array start_positions;
+            start_positions.push_back(current_pos);
+            flow_field_id = cached_flow_field_manager->request_flow_field(target_position, start_positions, footprint_class);
+        }
+        
+        // Aim one turning radius or so down the field so corners are started early enough
+        float turn_radius = move_speed / Math::max(turn_speed, 0.1f);
+        Vector3 aim = cached_flow_field_manager->get_flow_lookahead_point(flow_field_id, current_pos, turn_radius * flow_lookahead_scale);
+        Vector3 to_aim = aim - current_pos;
+        to_aim.y = 0;
+        if (to_aim.length_squared() > 0.01f) {
+            direction = to_aim.normalized();
+            following_field = true;
+        }
+    }
     
     Vector3 move_direction = direction;
     
-    if (path_blocked) {
-        move_direction = find_clear_direction(direction);
-        is_avoiding = true;
-    } else if (is_avoiding) {
-        // Check if direct path to target is now clear
-        float direct_distance = raycast_distance(direction, avoidance_radius);
-        if (direct_distance >= avoidance_radius * 0.9f) {
-            is_avoiding = false;
-        } else {
+    // The class field already keeps clearance from buildings, so obstacle traces
+    // are only needed without a field or once the vehicle is wedged
+    if (following_field && stuck_timer < stuck_raycast_delay) {
+        is_avoiding = false;
+    } else {
+        // Check if path ahead is blocked
+        float forward_distance = obstacle_clearance(direction, avoidance_radius);
+        bool path_blocked = forward_distance < avoidance_radius * 0.7f;
+        
+        if (path_blocked) {
             move_direction = find_clear_direction(direction);
+            is_avoiding = true;
+        } else if (is_avoiding) {
+            // Check if direct path to target is now clear
+            float direct_distance = obstacle_clearance(direction, avoidance_radius);
+            if (direct_distance >= avoidance_radius * 0.9f) {
+                is_avoiding = false;
+            } else {
+                move_direction = find_clear_direction(direction);
+            }
         }
     }
     
@@ -341,6 +401,12 @@ void Vehicle::move_to(const Vector3 &position) {
     target_position = position;
     target_position.y = get_global_position().y;
     is_moving = true;
+    
+    if (cached_flow_field_manager) {
+        PackedVector3Array start_positions;
+        start_positions.push_back(get_global_position());
+        flow_field_id = cached_flow_field_manager->request_flow_field(target_position, start_positions, footprint_class);
+    }
 }
 
 void Vehicle::stop_moving() {
@@ -352,6 +418,10 @@ bool Vehicle::get_is_moving() const {
     return is_moving;
 }
 
+Vector3 Vehicle::get_current_velocity() const {
+    return current_velocity;
+}
+
 void Vehicle::set_selected(bool selected) {
     if (is_selected == selected) return;
     
@@ -531,23 +601,32 @@ float Vehicle::get_model_scale() const {
     return model_scale;
 }
 
+void Vehicle::set_footprint_class(int size_class) {
+    footprint_class = size_class;
+}
+
+int Vehicle::get_footprint_class() const {
+    return footprint_class;
+}
+
+void Vehicle::set_flow_lookahead_scale(float scale) {
+    flow_lookahead_scale = Math::clamp(scale, 0.0f, 4.0f);
+}
+
+float Vehicle::get_flow_lookahead_scale() const {
+    return flow_lookahead_scale;
+}
+
 Vector3 Vehicle::calculate_avoidance_force() {
     // Simple backup force-based avoidance
     Vector3 avoidance_force = Vector3(0, 0, 0);
     
-    Ref<World3D> world = get_viewport()->get_world_3d();
-    if (world.is_null()) return avoidance_force;
-    
-    PhysicsDirectSpaceState3D *space_state = world->get_direct_space_state();
-    if (!space_state) return avoidance_force;
-    
-    Vector3 current_pos = get_global_position();
     Vector3 forward = current_velocity.normalized();
     if (forward.length_squared() < 0.01f) {
         forward = -get_transform().basis.get_column(2);
     }
     
-    float ahead_dist = raycast_distance(forward, wall_follow_distance);
+    float ahead_dist = obstacle_clearance(forward, wall_follow_distance);
     if (ahead_dist < wall_follow_distance) {
         float strength = (1.0f - ahead_dist / wall_follow_distance) * avoidance_strength;
         avoidance_force = -forward * strength;
@@ -559,6 +638,21 @@ Vector3 Vehicle::calculate_avoidance_force() {
 Vector3 Vehicle::calculate_separation_force() {
     Vector3 separation_force = Vector3(0, 0, 0);
     
+    if (cached_spatial_hash) {
+        Vector3 current_pos = get_global_position();
+        cached_spatial_hash->for_each_neighbor(current_pos, separation_radius, SPATIAL_LAYER_UNITS | SPATIAL_LAYER_VEHICLES,
+            [&](const SpatialHash::Entry &other, float distance_sq) {
+                if (other.node == this || distance_sq <= 0.0001f) return;
+                
+                float dist = Math::sqrt(distance_sq);
+                Vector3 away = current_pos - other.position;
+                away.y = 0;
+                float strength = (1.0f - dist / separation_radius) * separation_strength;
+                separation_force += (away / dist) * strength;
+            });
+        return separation_force;
+    }
+    
     Ref<World3D> world = get_viewport()->get_world_3d();
     if (world.is_null()) return separation_force;
     
@@ -610,7 +704,7 @@ Vector3 Vehicle::find_clear_direction(const Vector3 &preferred_dir) {
         float angle = (i * 2.0f * Math_PI) / num_directions;
         Vector3 dir = Vector3(Math::sin(angle), 0, Math::cos(angle));
         
-        float clearance = raycast_distance(dir, avoidance_radius);
+        float clearance = obstacle_clearance(dir, avoidance_radius);
         
         float clearance_score = clearance / avoidance_radius;
         float target_alignment = dir.dot(to_target);
@@ -639,22 +733,25 @@ Vector3 Vehicle::find_clear_direction(const Vector3 &preferred_dir) {
     return best_direction;
 }
 
-float Vehicle::raycast_distance(const Vector3 &direction, float max_distance) {
+float Vehicle::obstacle_clearance(const Vector3 &direction, float max_distance) {
+    Vector3 current_pos = get_global_position();
+    
+    // The nav grid's distance field covers buildings and impassable terrain without a physics query
+    if (cached_flow_field_manager) {
+        return cached_flow_field_manager->trace_obstacle_distance(current_pos, direction, max_distance);
+    }
+    
     Ref<World3D> world = get_viewport()->get_world_3d();
     if (world.is_null()) return max_distance;
     
     PhysicsDirectSpaceState3D *space_state = world->get_direct_space_state();
-    if (!space_state) return max_distance;
+    if (!space_state || cached_ray_query.is_null()) return max_distance;
     
-    Vector3 current_pos = get_global_position();
     Vector3 from = current_pos + Vector3(0, 0.5f, 0);
-    Vector3 to = from + direction.normalized() * max_distance;
-    
-    Ref<PhysicsRayQueryParameters3D> query = PhysicsRayQueryParameters3D::create(from, to);
-    query->set_collision_mask(obstacle_mask);
-    query->set_exclude(TypedArray<RID>::make(get_rid()));
+    cached_ray_query->set_from(from);
+    cached_ray_query->set_to(from + direction.normalized() * max_distance);
     
-    Dictionary result = space_state->intersect_ray(query);
+    Dictionary result = space_state->intersect_ray(cached_ray_query);
     
     if (result.is_empty()) {
         return max_distance;
@@ -665,7 +762,7 @@ float Vehicle::raycast_distance(const Vector3 &direction, float max_distance) {
 }
 
 bool Vehicle::check_path_blocked(const Vector3 &direction, float distance) {
-    return raycast_distance(direction, distance) < distance;
+    return obstacle_clearance(direction, distance) < distance;
 }
 
 void Vehicle::update_stuck_detection(double delta) {